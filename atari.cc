@@ -8,28 +8,40 @@
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "bank_switchers.h"
-#include "cpu.h"
-#include "disasm.h"
+#include "console.h"
+#include "display.h"
+#include "frame_export.h"
+#include "frame_stats.h"
 #include "input.h"
-#include "memory.h"
-#include "pia.h"
-#include "registers.h"
-#include "tia.h"
+#include "movie.h"
 
-std::unique_ptr<TIA> tia;
-std::unique_ptr<PIA> pia;
+std::unique_ptr<Console> console;
+std::unique_ptr<Movie> movie;
+// Owned by the TIA's NTSC, if we're exporting frames.
+FrameExport *frame_export = nullptr;
 
 std::unique_ptr<std::thread> emulation_thread;
+bool debug_mode = false;
 
 std::unordered_map<uint16_t, bool> break_points;
 
+// Run a single instruction. The debugger watches the electron gun after every
+// instruction, so the TIA can't wait for the next register write to render.
+void debug_step() {
+  console->cpu.execute_next_insn();
+  console->tia->process_tia();
+  console->tia->flush();
+  console->pia->process_pia();
+}
+
 void debug_loop() {
   std::string last_cmd = "help";
   do {
     printf("\n");
-    disasm_curr_insn();
+    console->cpu.disasm_curr_insn();
     printf(" > ");
 
     std::string cmd;
@@ -40,60 +52,55 @@ void debug_loop() {
       cmd = last_cmd;
 
     if (cmd == "step") {
-      execute_next_insn();
-      tia->process_tia();
-      pia->process_pia();
+      debug_step();
     } else if (cmd == "cont") {
       do {
-        execute_next_insn();
-        tia->process_tia();
-        pia->process_pia();
-      } while (should_execute && !break_points.count(program_counter));
+        debug_step();
+      } while (console->cpu.should_execute &&
+               !break_points.count(console->state.cpu.program_counter));
     } else if (cmd == "frame") {
       do {
-        execute_next_insn();
-        tia->process_tia();
-        pia->process_pia();
-      } while (should_execute && !tia->ntsc->gun_y);
+        debug_step();
+      } while (console->cpu.should_execute && !console->tia->ntsc->gun_y);
       do {
-        execute_next_insn();
-        tia->process_tia();
-        pia->process_pia();
-      } while (should_execute && tia->ntsc->gun_y);
+        debug_step();
+      } while (console->cpu.should_execute && console->tia->ntsc->gun_y);
     } else if (cmd == "scan") {
-      int old_gun_y = tia->ntsc->gun_y;
+      int old_gun_y = console->tia->ntsc->gun_y;
       do {
-        execute_next_insn();
-        tia->process_tia();
-        pia->process_pia();
-      } while (should_execute && tia->ntsc->gun_y == old_gun_y);
+        debug_step();
+      } while (console->cpu.should_execute &&
+               console->tia->ntsc->gun_y == old_gun_y);
     } else if (cmd == "dump reg") {
-      dump_regs();
+      console->cpu.dump_regs();
     } else if (cmd == "dump mem") {
-      dump_memory();
+      console->bus.dump_memory();
     } else if (cmd == "dump tia") {
-      tia->dump_tia();
+      console->tia->dump_tia();
     } else if (cmd == "dump pia") {
-      pia->dump_pia();
+      console->pia->dump_pia();
+    } else if (cmd == "stats") {
+      frame_stats.dump();
+      console->tia->dump_line_cache_stats();
     } else if (cmd == "dump" || cmd == "dump all") {
-      dump_regs();
-      dump_memory();
-      tia->dump_tia();
-      pia->dump_pia();
+      console->cpu.dump_regs();
+      console->bus.dump_memory();
+      console->tia->dump_tia();
+      console->pia->dump_pia();
     } else if (cmd.rfind("set ") != std::string::npos) {
       bool value = cmd[0] == 'u' && cmd[1] == 'n' ? false : true;
       std::string direction = cmd.substr(cmd.rfind("set ") + strlen("set "), cmd.length());
 
       if (direction == "up") {
-        player0_up = value;
+        controls.player0_up = value;
       } else if (direction == "down") {
-        player0_down = value;
+        controls.player0_down = value;
       } else if (direction == "left") {
-        player0_left = value;
+        controls.player0_left = value;
       } else if (direction == "right") {
-        player0_right = value;
+        controls.player0_right = value;
       } else if (direction == "fire") {
-        player0_fire = value;
+        controls.player0_fire = value;
       } else {
         printf("Error! Invalid direction %s\n", direction.c_str());
       }
@@ -122,7 +129,7 @@ void debug_loop() {
         break_points.erase(break_point);
       }
     } else if (cmd == "exit") {
-      should_execute = false;
+      console->cpu.should_execute = false;
     } else if (cmd == "help") {
       printf("Possible commands:\n");
       printf("step - steps program\n");
@@ -134,6 +141,7 @@ void debug_loop() {
       printf("dump tia - dump TIA state\n");
       printf("dump pia - dump PIA state\n");
       printf("dump all - dump all available state\n");
+      printf("stats - print frame timing statistics\n");
       printf("break XYZW - sets break point to hex address 0xXYZW\n");
       printf("del XYZW - delete break point at hex address 0xXYZW\n");
       printf("[un]set (up|down|left|right|fire) - toggle an input\n");
@@ -149,105 +157,152 @@ void debug_loop() {
     // Flush as much of the screen as we have to the user. This is useful for
     // debugging rendering, so we can watch the scanlines draw as we "step" the
     // program.
-    tia->ntsc->debug_swap_buf();
-  } while (should_execute);
+    console->tia->ntsc->debug_swap_buf();
+  } while (console->cpu.should_execute);
 
   printf("program exiting\n");
   exit(0);
 }
 
-void emulate(bool debug) {
+// Same as the main loop, but attributes host time to the CPU, TIA, and PIA for
+// the frame statistics. This is kept separate so the clock reads cost nothing
+// when nobody is looking at the numbers.
+void emulate_timed() {
+  uint64_t cpu_start = host_time_ns();
+  while (console->cpu.should_execute) {
+    console->cpu.execute_next_insn();
+    uint64_t tia_start = host_time_ns();
+    console->tia->process_tia();
+    uint64_t pia_start = host_time_ns();
+    console->pia->process_pia();
+    uint64_t pia_end = host_time_ns();
+
+    frame_stats.add_cpu(tia_start - cpu_start);
+    frame_stats.add_tia(pia_start - tia_start);
+    frame_stats.add_pia(pia_end - pia_start);
+    cpu_start = pia_end;
+  }
+}
+
+// Same as the main loop, but a frame at a time, so the movie can be fed in
+// between frames. Stops after |frame_limit| frames if it's set, or when the
+// movie being played back runs out.
+void run_frames(uint64_t frame_limit) {
+  while (console->cpu.should_execute) {
+    uint64_t frame = console->tia->ntsc->frames;
+    if (frame_limit && frame >= frame_limit)
+      break;
+    if (movie && !movie->next_frame(controls))
+      break;
+
+    console->run_frame();
+  }
+}
+
+void print_memory_hash() {
+  printf("RAM hash after %lu frames: %016lx\n", console->tia->ntsc->frames,
+         console->bus.hash_memory());
+  fflush(stdout);
+}
+
+// Same as the main loop, but stops after |frame_limit| frames or at the end of
+// the movie, and prints a hash of RAM. Skipping frames must never change what
+// the game does, so the hash should come out the same no matter how we render.
+void emulate_frames(uint64_t frame_limit) {
+  run_frames(frame_limit);
+  print_memory_hash();
+
+  console->cpu.should_execute = false;
+  request_quit();
+}
+
+void emulate(bool debug, uint64_t frame_limit) {
   if (debug) {
     debug_loop();
+  } else if (frame_limit || movie) {
+    emulate_frames(frame_limit);
+  } else if (frame_stats.per_subsystem) {
+    emulate_timed();
   } else {
-    while (should_execute) {
-      execute_next_insn();
-      tia->process_tia();
-      pia->process_pia();
+    while (console->cpu.should_execute) {
+      console->cpu.execute_next_insn();
+      console->tia->process_tia();
+      console->pia->process_pia();
     }
   }
 }
 
 void load_program_file(const char *filename, int scale,
-                       BankSwitcherType bank_switcher_type) {
-  FILE *program_file = fopen(filename, "r");
-  if (!program_file) {
-    printf("could not open %s\n", filename);
-    exit(-1);
-  }
+                       BankSwitcherType bank_switcher_type, double speed,
+                       bool pipelined, bool headless) {
+  console = std::make_unique<Console>(read_rom(filename, bank_switcher_type),
+                                      controls);
+  console->tia = std::make_unique<TIA>(
+      console->state.tia, console->state.cpu.cycle_num, controls, scale, speed,
+      pipelined, headless);
+  if (speed == NTSC::audio_speed)
+    console->tia->match_refresh(host_refresh_hz());
+  console->power_on();
+}
 
-  tia = std::make_unique<TIA>(scale);
-  pia = std::make_unique<PIA>();
-
-  auto ram = std::make_shared<RamRegion>(RAM_START, RAM_END);
-  std::vector<uint16_t> bank_addrs;
-  std::shared_ptr<MemoryRegion> rom = nullptr;
-  size_t file_size = 0x1000;
-  uint8_t *rom_backing = nullptr;
-  switch (bank_switcher_type) {
-  case BankSwitcherType::none:
-    rom_backing = (uint8_t *)malloc(file_size);
-    fread(rom_backing, 1, file_size, program_file);
-    rom = std::make_shared<RomRegion>(ROM_START, ROM_END, rom_backing);
-    break;
-  case BankSwitcherType::atari16k:
-    bank_addrs.push_back(0xFF6);
-    bank_addrs.push_back(0xFF7);
-    file_size += 0x2000;
-  // Fall through is intentional here. 0xFF8 and 0xFF9 are recycled between both
-  // schemes.
-  case BankSwitcherType::atari8k:
-    bank_addrs.push_back(0xFF8);
-    bank_addrs.push_back(0xFF9);
-    file_size += 0x1000;
-    rom_backing = (uint8_t *)malloc(file_size);
-    fread(rom_backing, 1, file_size, program_file);
-    rom = std::make_shared<AtariRomRegion>(ROM_START, ROM_END, rom_backing,
-                                           bank_addrs);
-    break;
-  case BankSwitcherType::atari32k:
-    file_size = 0x8000;
-    rom_backing = (uint8_t *)malloc(file_size);
-    fread(rom_backing, 1, file_size, program_file);
-    for (int i = 0; i < 8; i++)
-      bank_addrs.push_back(0xFF4 + i);
-    rom = std::make_shared<AtariRomRegion>(ROM_START, ROM_END, rom_backing,
-                                           bank_addrs);
-    break;
-  default:
-    printf("Error! Invalid bankswitching scheme\n");
-    exit(-1);
-  }
+void capture_tia_trace(const char *filename) {
+  console->tia->start_trace(filename);
+}
 
-  fclose(program_file);
-  if (rom_backing)
-    free(rom_backing);
+void load_movie(const char *filename, bool recording) {
+  movie = std::make_unique<Movie>(filename, recording);
+}
 
-  // These are the most commonly used "mirrors" of the TIA and normal RAM
-  // memory.
-  auto ram_mirror =
-      std::make_shared<MirrorRegion>(RAM_START + 0x100, RAM_END + 0x100, ram);
-  auto tia_mirror = std::make_shared<MirrorRegion>(
-      TIA_START + 0x100, TIA_END + 0x100, tia->get_memory_region());
+void export_frames(const char *name, bool lockstep) {
+  NTSC &ntsc = *console->tia->ntsc;
+  std::unique_ptr<Display> display = ntsc.replace_display(nullptr);
+  auto exporter =
+      std::make_unique<FrameExport>(name, lockstep, std::move(display),
+                                    ntsc.frames, console->bus.get_ram(),
+                                    controls);
+  frame_export = exporter.get();
+  ntsc.replace_display(std::move(exporter));
+  // The consumer would never see another frame.
+  drawing_required = true;
 
-  memory_regions.push_back(ram);
+  // A headless TIA doesn't start drawing until the first frame is over.
+  console->tia->set_drawing(true);
+}
 
-  memory_regions.push_back(rom);
-  for (int addr = 0x1000; addr < rom->start_addr; addr += 0x1000)
-    memory_regions.push_back(
-        std::make_shared<MirrorRegion>(addr, addr + 0xFFF, rom));
+void render_audio(const char *filename, uint64_t frame_limit) {
+  console->cpu.should_execute = true;
+  console->tia->start_wav(filename);
 
-  memory_regions.push_back(tia->get_memory_region());
-  memory_regions.push_back(pia->get_memory_region());
-  memory_regions.push_back(ram_mirror);
-  memory_regions.push_back(tia_mirror);
+  uint64_t start_cycle = console->state.cpu.cycle_num;
+  uint64_t start_time = host_time_ns();
+  run_frames(frame_limit);
+  console->tia->stop_wav();
+  double host_seconds = (host_time_ns() - start_time) / 1000000000.0;
+  double emulated_seconds = (console->state.cpu.cycle_num - start_cycle) /
+                            (NTSC::color_clock_hz / TIA::tia_cycle_ratio);
 
-  stack_region = ram;
+  printf("Rendered %.2f seconds of audio in %.2f seconds, %.1f emulated "
+         "seconds per second\n",
+         emulated_seconds, host_seconds, emulated_seconds / host_seconds);
+  print_memory_hash();
+}
 
-  init_registers(read_word(RESET_VECTOR));
+void start_emulation_thread(bool debug, uint64_t frame_limit) {
+  console->cpu.should_execute = true;
+  debug_mode = debug;
+  emulation_thread =
+      std::make_unique<std::thread>(emulate, debug, frame_limit);
 }
 
-void start_emulation_thread(bool debug) {
-  should_execute = true;
-  emulation_thread = std::make_unique<std::thread>(emulate, debug);
+void stop_emulation_thread() {
+  console->cpu.should_execute = false;
+  if (frame_export)
+    frame_export->stop();
+
+  // The debugger is most likely blocked waiting on STDIN, so don't wait for it.
+  if (debug_mode) {
+    emulation_thread->detach();
+  } else {
+    emulation_thread->join();
+  }
 }
@@ -1,5 +1,7 @@
 #include "bank_switchers.h"
 
+#include <stdint.h>
+
 #ifndef ATARI_H
 #define ATARI_H
 
@@ -17,12 +19,41 @@
 #define STACK_TOP 0x1FF
 #define STACK_BOTTOM 0x100
 
-// Loads the given program file into ROM memory.
+// Loads the given program file into ROM memory. |speed| is the emulation speed
+// as a multiple of real time, or 0 to run unthrottled. If |pipelined| is set,
+// frames are drawn on a separate render thread. If |headless| is set, there's
+// no window at all.
 void load_program_file(const char *filename, int scale,
-                       BankSwitcherType bank_switcher_type);
+                       BankSwitcherType bank_switcher_type, double speed,
+                       bool pipelined, bool headless = false);
+
+// Logs every TIA register write to the given file, starting from the current
+// TIA state. The trace can be replayed without a CPU by tia_bench.
+void capture_tia_trace(const char *filename);
+
+// Plays back the controls from the given movie file, or records them to it if
+// |recording| is set. Emulation stops when the movie runs out.
+void load_movie(const char *filename, bool recording);
+
+// Publishes every frame drawn, along with RAM, to the POSIX shared memory
+// segment |name| for other processes, and takes their joystick input back. If
+// |lockstep| is set, each frame waits for a consumer to answer it. See
+// shm_frames.h.
+void export_frames(const char *name, bool lockstep);
+
+// Runs emulation on this thread as fast as it will go, writing the audio to
+// the given WAV file, until |frame_limit| frames if it's set or the end of the
+// movie. Prints how many emulated seconds we got through per second. Meant for
+// a headless emulator.
+void render_audio(const char *filename, uint64_t frame_limit);
 
 // Starts emulation in a separate thread. This is to give QT5 (or whatever the
-// frontend will be) the main thread for event handling.
-void start_emulation_thread(bool debug);
+// frontend will be) the main thread for event handling. If |frame_limit| is
+// set, we exit after that many frames and print a hash of RAM, so different
+// rendering modes can be checked against each other.
+void start_emulation_thread(bool debug, uint64_t frame_limit = 0);
+
+// Stops the emulation thread, e.g. when the frontend's window is closed.
+void stop_emulation_thread();
 
 #endif
@@ -0,0 +1,128 @@
+#include "atari_bus.h"
+
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+
+// Decoded banks by ROM hash, bank switching type, and bank. Only weak
+// references are kept here, so a bank goes away along with the last console
+// using it.
+static std::mutex bank_code_mutex;
+static std::map<std::string, std::weak_ptr<const AtariBus::BankCode>>
+    bank_codes;
+
+// Looks up bank |bank| of |cartridge|'s ROM, decoding it if no other console
+// has it.
+static std::shared_ptr<const AtariBus::BankCode>
+find_bank_code(Cartridge &cartridge, int bank) {
+  const RomImage &rom = cartridge.get_rom();
+  std::string key = rom.hash() + " " + std::to_string(rom.type) + " " +
+                    std::to_string(bank);
+
+  std::lock_guard<std::mutex> lock(bank_code_mutex);
+  std::shared_ptr<const AtariBus::BankCode> code = bank_codes[key].lock();
+  if (code)
+    return code;
+
+  // The CPU doesn't read bank switching addresses ahead of time, so they're
+  // decoded as zeros, the same as if it had decoded them itself.
+  uint8_t bytes[0x1000];
+  memcpy(bytes, rom.bank_data(bank), sizeof(bytes));
+  for (int offset = 0; offset < 0x1000; offset++) {
+    if (cartridge.is_bank_addr(0x1000 | offset))
+      bytes[offset] = 0;
+  }
+
+  // The last two bytes are the IRQ vector, so no instruction runs off the end
+  // of the bank in practice.
+  auto new_code = std::make_shared<AtariBus::BankCode>(sizeof(bytes));
+  Cpu6502<AtariBus>::decode_code(bytes, sizeof(bytes), new_code->data());
+  bank_codes[key] = new_code;
+  return new_code;
+}
+
+void AtariBus::connect(Cpu6502<AtariBus> *cpu, TIA *tia, PIA *pia,
+                       std::unique_ptr<Cartridge> cartridge) {
+  this->cpu = cpu;
+  this->tia = tia;
+  this->pia = pia;
+  this->cartridge = std::move(cartridge);
+
+  bank_code.clear();
+  for (int bank = 0; bank < this->cartridge->num_banks; bank++)
+    bank_code.push_back(find_bank_code(*this->cartridge, bank));
+
+  memset(regs.ram, 0, sizeof(regs.ram));
+  regs.crashed = false;
+  regs.crash_program_counter = 0;
+}
+
+void AtariBus::switch_bank(uint16_t addr) {
+  if (!cartridge->switch_bank(addr))
+    return;
+
+  // We have to dump the entire instruction cache.
+  for (int page = 0x10; page < 0x100; page++)
+    dirty_pages[page] = true;
+}
+
+void AtariBus::warn(const char *error, uint16_t addr) {
+  printf(error, addr);
+  printf(" PC: %x\n", cpu->regs.program_counter);
+}
+
+void AtariBus::invalid_access(const char *error, uint16_t addr) {
+  printf(error, addr);
+  cpu->panic();
+}
+
+void AtariBus::panic() {
+  if (!exit_on_panic) {
+    regs.crashed = true;
+    regs.crash_program_counter = cpu->regs.program_counter;
+    return;
+  }
+
+  dump_memory();
+  fflush(stdout);
+  usleep(1000);
+  exit(-1);
+}
+
+void AtariBus::registers_loaded() {
+  cartridge->reload_bank();
+
+  for (int page = 0; page < 0x100; page++)
+    dirty_pages[page] = true;
+}
+
+// Dumps all 128 bytes of RAM to STDOUT
+void AtariBus::dump_memory() {
+  printf("RAM:\n");
+  printf("  ");
+  for (int low_nibble = 0; low_nibble <= 0xF; low_nibble++) {
+    printf("%x  ", low_nibble);
+  }
+  printf("\n");
+  for (int high_nibble = 0x8; high_nibble <= 0xF; high_nibble++) {
+    printf("%x ", high_nibble);
+    for (int low_nibble = 0; low_nibble <= 0xF; low_nibble++) {
+      printf("%02x ", regs.ram[(high_nibble << 4 | low_nibble) - RAM_START]);
+    }
+    printf("\n");
+  }
+  printf("\n");
+}
+
+uint64_t AtariBus::hash_memory() {
+  uint64_t hash = 0xcbf29ce484222325;
+  for (size_t i = 0; i < sizeof(regs.ram); i++) {
+    hash ^= regs.ram[i];
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
@@ -0,0 +1,164 @@
+#include <memory>
+#include <stdint.h>
+
+#include "atari.h"
+#include "bank_switchers.h"
+#include "cpu6502.h"
+#include "pia.h"
+#include "tia.h"
+
+#ifndef ATARI_BUS_H
+#define ATARI_BUS_H
+
+// The Atari 2600's address bus, as seen by the 6502 core. Every address is
+// decoded right here rather than by looking up a memory region, so reads and
+// writes inline into the instructions.
+//
+// Because of quirks in the Atari's addressing bus, multiple addresses can
+// point to the same thing. Only 13 address lines are connected, so the
+// cartridge is mirrored every 0x1000 bytes starting at 0x1000. The TIA and RAM
+// in the zero page are also mirrored in page 1, which is where the stack
+// lives.
+class AtariBus {
+public:
+  typedef Cpu6502<AtariBus>::CachedInsn CachedInsn;
+
+  // One bank of a cartridge, decoded ahead of time for the CPU. Banks are
+  // shared by every console running the same cartridge. See
+  // find_bank_code().
+  typedef std::vector<CachedInsn> BankCode;
+
+  // RAM, the cartridge's bank, and whether the CPU crashed. A console keeps
+  // these with the rest of its state, so the bus is handed a block of its
+  // own when it's built.
+  struct Registers {
+    uint8_t ram[RAM_END - RAM_START + 1];
+    // See Cartridge.
+    int bank;
+    // Where the CPU was when it crashed. The instruction may finish running
+    // and move the program counter on afterwards.
+    uint16_t crash_program_counter;
+    bool crashed;
+    uint8_t padding;
+  };
+
+private:
+  Registers &regs;
+  bool dirty_pages[256] = {false};
+
+  Cpu6502<AtariBus> *cpu = nullptr;
+  TIA *tia = nullptr;
+  PIA *pia = nullptr;
+  std::unique_ptr<Cartridge> cartridge;
+  // Every bank of |cartridge|.
+  std::vector<std::shared_ptr<const BankCode>> bank_code;
+
+  void switch_bank(uint16_t addr);
+  // Print |error| along with the CPU's program counter.
+  void warn(const char *error, uint16_t addr);
+  void invalid_access(const char *error, uint16_t addr);
+
+public:
+  AtariBus(Registers &regs) : regs(regs) {}
+
+  // Plugs in the CPU, the chips, and the cartridge, and clears RAM. Nothing
+  // can be read or written until this is called.
+  void connect(Cpu6502<AtariBus> *cpu, TIA *tia, PIA *pia,
+               std::unique_ptr<Cartridge> cartridge);
+
+  uint8_t read_byte(uint16_t addr) {
+    if (addr >= 0x1000) {
+      if (cartridge->is_bank_addr(addr))
+        switch_bank(addr);
+      return cartridge->read_byte(addr);
+    } else if (addr < 0x200) {
+      // RAM is the top half of the page, and the TIA is the bottom half.
+      if (addr & RAM_START)
+        return regs.ram[addr & (RAM_END - RAM_START)];
+      uint8_t val;
+      if (!tia->memory_read_hook(addr & 0xFF, val))
+        warn("Warning! Invalid TIA read at %x.", addr);
+      return val;
+    } else if (addr >= PIA_START && addr <= PIA_END) {
+      uint8_t val;
+      if (!pia->memory_read_hook(addr, val))
+        warn("Warning! Invalid PIA read at %x.", addr);
+      return val;
+    }
+
+    invalid_access("Error! Invalid read at address %x\n", addr);
+    return -1;
+  }
+
+  void write_byte(uint16_t addr, uint8_t val) {
+    if (addr >= 0x1000) {
+      // Writing to bank switch registers is valid, no other writes are.
+      if (cartridge->is_bank_addr(addr)) {
+        switch_bank(addr);
+      } else {
+        invalid_access("Error! Attempted to write to ROM address %x\n", addr);
+      }
+    } else if (addr < 0x200) {
+      if (addr & RAM_START) {
+        regs.ram[addr & (RAM_END - RAM_START)] = val;
+        // Either page might have code in it.
+        dirty_pages[0] = true;
+        dirty_pages[1] = true;
+      } else if (!tia->memory_write_hook(addr & 0xFF, val)) {
+        warn("Warning! Invalid TIA write at %x.", addr);
+      }
+    } else if (addr >= PIA_START && addr <= PIA_END) {
+      if (!pia->memory_write_hook(addr, val))
+        invalid_access("Error! Invalid PIA write at %x\n", addr);
+    } else {
+      invalid_access("Error! Invalid write at address %x\n", addr);
+    }
+  }
+
+  // Reading the TIA or PIA can change their state, and so can reading bank
+  // switching addresses.
+  bool has_side_effect(uint16_t addr) {
+    if (addr >= 0x1000) {
+      return cartridge->is_bank_addr(addr);
+    } else if (addr < 0x200) {
+      return !(addr & RAM_START);
+    } else if (addr >= PIA_START && addr <= PIA_END) {
+      return true;
+    }
+
+    invalid_access("Error! Invalid address %x\n", addr);
+    return true;
+  }
+
+  // Cache control for the CPU's parsed instructions.
+  bool is_dirty_page(uint16_t addr) { return dirty_pages[addr >> 8]; }
+  void mark_page_clean(uint16_t addr) { dirty_pages[addr >> 8] = false; }
+
+  // The cartridge never changes, so its code is decoded a bank at a time and
+  // shared. RAM is left to the CPU.
+  const CachedInsn *shared_code(uint16_t addr) {
+    if (addr < 0x1000)
+      return nullptr;
+    return &(*bank_code[cartridge->get_bank()])[addr & 0xF00];
+  }
+
+  // Called by the CPU after it dumps its registers. Dumps RAM and exits, or
+  // if |exit_on_panic| is cleared, just sets |regs.crashed| and returns.
+  void panic();
+  bool exit_on_panic = true;
+
+  // Call after loading a saved state over the Registers. Throws out every
+  // instruction the CPU has cached.
+  void registers_loaded();
+
+  // Print all 128 bytes of RAM to STDOUT
+  void dump_memory();
+
+  // FNV-1a hash of all 128 bytes of RAM
+  uint64_t hash_memory();
+
+  // All 128 bytes of RAM, starting from RAM_START.
+  const uint8_t *get_ram() { return regs.ram; }
+};
+
+#endif
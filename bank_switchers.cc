@@ -1,59 +1,114 @@
 #include "bank_switchers.h"
 
-#include "registers.h"
-
-#include <stdint.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-AtariRomRegion::AtariRomRegion(uint16_t start_addr, uint16_t end_addr,
-                               uint8_t *init_data,
-                               std::vector<uint16_t> bank_addrs) {
-  this->num_banks = bank_addrs.size();
-  this->start_addr = start_addr;
-  this->end_addr = end_addr;
-  this->bank = num_banks - 1;
-  type = ROM;
-
-  size_t len = (this->end_addr - this->start_addr + 1) * num_banks;
-  backing_memory = (uint8_t *)malloc(len);
-
-  memcpy(backing_memory, init_data, len);
+#include "sha256.h"
 
-  for (int i = 0; i < bank_addrs.size(); i++)
-    bank_map[bank_addrs[i]] = i;
+// The number of banks and the first bank switching address for each type.
+static void get_layout(BankSwitcherType type, int &num_banks,
+                       uint16_t &first_bank_addr) {
+  switch (type) {
+  case BankSwitcherType::none:
+    num_banks = 1;
+    first_bank_addr = 0;
+    break;
+  case BankSwitcherType::atari8k:
+    num_banks = 2;
+    first_bank_addr = 0xFF8;
+    break;
+  case BankSwitcherType::atari16k:
+    num_banks = 4;
+    first_bank_addr = 0xFF6;
+    break;
+  case BankSwitcherType::atari32k:
+    num_banks = 8;
+    first_bank_addr = 0xFF4;
+    break;
+  default:
+    printf("Error! Invalid bankswitching scheme\n");
+    exit(-1);
+  }
 }
 
-AtariRomRegion::~AtariRomRegion() { free(backing_memory); }
+size_t RomImage::rom_size(BankSwitcherType type) {
+  int num_banks;
+  uint16_t first_bank_addr;
+  get_layout(type, num_banks, first_bank_addr);
+  return 0x1000 * num_banks;
+}
 
-uint8_t AtariRomRegion::read_byte(uint16_t addr) {
-  if (bank_map.count(addr & 0xFFF)) {
-    bank = bank_map[addr & 0xFFF];
+RomImage::RomImage(const char *filename, BankSwitcherType type)
+    : size(rom_size(type)), type(type), num_banks(size / 0x1000) {
+  int fd = open(filename, O_RDONLY);
+  struct stat stat_buf;
+  if (fd < 0 || fstat(fd, &stat_buf)) {
+    printf("could not open %s\n", filename);
+    exit(-1);
+  }
 
-    // We have to dump the entire instruction cache.
-    for (int i = 0x1000; i < end_addr; i += 0x100)
-      mark_page_dirty(i);
+  if ((size_t)stat_buf.st_size >= size) {
+    mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+      printf("Error! Could not map %s\n", filename);
+      exit(-1);
+    }
+    bytes = (const uint8_t *)mapping;
+  } else {
+    copy.resize(size);
+    if (read(fd, copy.data(), size) < 0) {
+      printf("could not read %s\n", filename);
+      exit(-1);
+    }
+    bytes = copy.data();
   }
+  close(fd);
 
-  return backing_memory[addr - start_addr + 0x1000 * bank];
+  sha256 = sha256_hex(bytes, size);
 }
 
-// Writing to bank switch registers is valid, no other writes are.
-void AtariRomRegion::write_byte(uint16_t addr, uint8_t val) {
-  if (bank_map.count(addr & 0xFFF)) {
-    bank = bank_map[addr & 0xFFF];
+RomImage::~RomImage() {
+  if (mapping)
+    munmap(mapping, size);
+}
 
-    for (int i = 0x1000; i < end_addr; i += 0x100)
-      mark_page_dirty(i);
-  } else {
-    printf("Error! Attempted to write to ROM address %x\n", addr);
-    panic();
-  }
+std::shared_ptr<const RomImage> read_rom(const char *filename,
+                                         BankSwitcherType type) {
+  return std::make_shared<const RomImage>(filename, type);
+}
+
+Cartridge::Cartridge(std::shared_ptr<const RomImage> rom, int &bank)
+    : rom(rom), bank(bank), num_banks(rom->num_banks) {
+  int layout_banks;
+  get_layout(rom->type, layout_banks, first_bank_addr);
+  set_bank(num_banks - 1);
+}
+
+bool Cartridge::switch_bank(uint16_t addr) {
+  int new_bank = (addr & 0xFFF) - first_bank_addr;
+  if (new_bank == bank)
+    return false;
+
+  set_bank(new_bank);
+  return true;
 }
 
-// We don't want the instruction cache to accidentally switch banks just because
-// we're in the same page.
-bool AtariRomRegion::has_side_effect(uint16_t addr) {
-  return bank_map.count(addr & 0xFFF);
+bool parse_bank_switcher_type(const char *name, BankSwitcherType &type) {
+  if (!strcmp(name, "none")) {
+    type = BankSwitcherType::none;
+  } else if (!strcmp(name, "atari8k")) {
+    type = BankSwitcherType::atari8k;
+  } else if (!strcmp(name, "atari16k")) {
+    type = BankSwitcherType::atari16k;
+  } else if (!strcmp(name, "atari32k")) {
+    type = BankSwitcherType::atari32k;
+  } else {
+    return false;
+  }
+  return true;
 }
@@ -1,6 +1,7 @@
-#include "memory.h"
-
-#include <unordered_map>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
 #include <vector>
 
 #ifndef BANK_SWITCHERS_H
@@ -13,25 +14,95 @@ enum BankSwitcherType {
   atari32k,
 };
 
+// A whole cartridge of 4KB banks, read from a file once and never changed, so
+// every console running it can share the one copy. When the file is the full
+// size, it's mapped read only rather than read in, so even consoles in other
+// processes share it through the page cache. Short files are copied and padded
+// out with zeros.
+class RomImage {
+  const uint8_t *bytes;
+  size_t size;
+  // The file's mapping, or the padded copy of a short file.
+  void *mapping = nullptr;
+  std::vector<uint8_t> copy;
+
+  std::string sha256;
+
+public:
+  const BankSwitcherType type;
+  const int num_banks;
+
+  RomImage(const char *filename, BankSwitcherType type);
+  ~RomImage();
+
+  // Shared by the consoles running it, so it can't be copied.
+  RomImage(const RomImage &) = delete;
+  RomImage &operator=(const RomImage &) = delete;
+
+  const uint8_t *data() const { return bytes; }
+  const uint8_t *bank_data(int bank) const { return &bytes[0x1000 * bank]; }
+
+  // SHA-256 of the whole cartridge, as hex, for keying anything worked out
+  // from the ROM.
+  const std::string &hash() const { return sha256; }
+
+  // How many bytes of ROM a cartridge of the given type holds.
+  static size_t rom_size(BankSwitcherType type);
+};
+
+// Reads a whole cartridge of the given type from |filename|. Missing bytes at
+// the end of a short file are left as zero.
+std::shared_ptr<const RomImage> read_rom(const char *filename,
+                                         BankSwitcherType type);
+
 // Atari bank switching is very simple. The banks are mapped to memory
 // addresses, and if those addresses are either read or written, the
 // corresponding bank is swapped in. ROM addresses are mirrored every 0x1000
 // starting at 0x1000.
-
-class AtariRomRegion : public MemoryRegion {
+class Cartridge {
 private:
-  uint8_t *backing_memory;
-  int bank = 0;
-  int num_banks = 0;
-  std::unordered_map<uint16_t, int> bank_map; // The magic memory addresses.
+  std::shared_ptr<const RomImage> rom;
+  // The bank that's swapped in, which is kept with the rest of the console's
+  // state.
+  int &bank;
+  // The bytes of |bank|.
+  const uint8_t *bank_bytes;
+  // The magic memory addresses. Touching |first_bank_addr| + N swaps in bank
+  // N.
+  uint16_t first_bank_addr;
+
+  void set_bank(int bank) {
+    this->bank = bank;
+    bank_bytes = rom->bank_data(bank);
+  }
 
 public:
-  AtariRomRegion(uint16_t start_addr, uint16_t end_addr, uint8_t *init_data,
-                 std::vector<uint16_t> bank_addrs);
-  ~AtariRomRegion();
-  uint8_t read_byte(uint16_t addr) override;
-  void write_byte(uint16_t addr, uint8_t val) override;
-  bool has_side_effect(uint16_t addr) override;
+  const int num_banks;
+
+  // The last bank is swapped in at power on.
+  Cartridge(std::shared_ptr<const RomImage> rom, int &bank);
+
+  const RomImage &get_rom() { return *rom; }
+
+  // Whether reading or writing |addr| switches banks.
+  bool is_bank_addr(uint16_t addr) {
+    int offset = (addr & 0xFFF) - first_bank_addr;
+    return num_banks > 1 && offset >= 0 && offset < num_banks;
+  }
+
+  // Swaps in the bank for |addr|, which must be a bank switching address.
+  // Returns whether the bank actually changed.
+  bool switch_bank(uint16_t addr);
+
+  uint8_t read_byte(uint16_t addr) { return bank_bytes[addr & 0xFFF]; }
+
+  int get_bank() { return bank; }
+  // Catches up with |bank| after a saved state has been loaded over it.
+  void reload_bank() { bank_bytes = rom->bank_data(bank); }
 };
 
+// Looks up a bank switching type by its command line name, e.g. "atari8k".
+// Returns false if there's no such type.
+bool parse_bank_switcher_type(const char *name, BankSwitcherType &type);
+
 #endif
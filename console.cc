@@ -0,0 +1,43 @@
+#include "console.h"
+
+#include "atari.h"
+
+Console::Console(std::shared_ptr<const RomImage> rom,
+                 const Controls &controls)
+    : state(), controls(controls), bus(state.bus), cpu(bus, state.cpu) {
+  cartridge = std::make_unique<Cartridge>(rom, state.bus.bank);
+  pia = std::make_unique<PIA>(state.pia, state.cpu.cycle_num, controls);
+}
+
+void Console::power_on() {
+  bus.connect(&cpu, tia.get(), pia.get(), std::move(cartridge));
+  cpu.reset(cpu.read_word(RESET_VECTOR));
+  cpu.should_execute = true;
+}
+
+bool Console::run_frame() {
+  uint64_t frame = tia->ntsc->frames;
+  uint64_t give_up_cycle = state.cpu.cycle_num + max_frame_cycles;
+  while (cpu.should_execute && tia->ntsc->frames == frame) {
+    if (state.cpu.cycle_num >= give_up_cycle)
+      return false;
+    cpu.execute_next_insn();
+    tia->process_tia();
+    pia->process_pia();
+  }
+  return true;
+}
+
+void Console::save_state(Snapshot &snapshot) {
+  // Brings the TIA's registers up to date first.
+  tia->save_state(snapshot.tia);
+  snapshot.state = state;
+  snapshot.should_execute = cpu.should_execute;
+}
+
+void Console::load_state(const Snapshot &snapshot) {
+  state = snapshot.state;
+  cpu.should_execute = snapshot.should_execute;
+  bus.registers_loaded();
+  tia->load_state(snapshot.tia);
+}
@@ -0,0 +1,81 @@
+#include <memory>
+#include <stdint.h>
+#include <type_traits>
+
+#include "atari_bus.h"
+#include "bank_switchers.h"
+#include "cpu6502.h"
+#include "input.h"
+#include "pia.h"
+#include "tia.h"
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+// A whole Atari 2600: the CPU, the bus, the chips, and the cartridge. Consoles
+// only share what never changes, the ROM and its decoded code, so any number
+// of them can run at once, each on its own thread.
+class Console {
+  std::unique_ptr<Cartridge> cartridge;
+
+public:
+  // Everything about the machine that changes as it runs, apart from the
+  // electron gun and the sound channels, in one block of plain bytes that
+  // each chip is handed its part of. What every instruction touches comes
+  // first, so the CPU's registers, the PIA's timer, and the TIA's counters
+  // share the first cache line, and the whole thing is five lines. That
+  // keeps many consoles on one core from crowding each other out of L1, and
+  // makes saving and loading a state one copy.
+  struct alignas(64) State {
+    Cpu6502Registers cpu;
+    PIA::Registers pia;
+    TIA::Registers tia;
+    AtariBus::Registers bus;
+    uint8_t padding[32];
+  };
+  static_assert(sizeof(State) == 5 * 64 &&
+                    std::has_unique_object_representations_v<State>,
+                "Console::State must not have any padding");
+  State state;
+
+  // What's plugged into the controller ports. The TIA and PIA read these.
+  const Controls &controls;
+
+  AtariBus bus;
+  Cpu6502<AtariBus> cpu;
+  std::unique_ptr<TIA> tia;
+  std::unique_ptr<PIA> pia;
+
+  // |rom| is shared with any other console running the same cartridge. How
+  // the TIA draws depends on what the console is for, so it's up to the
+  // caller to build one off of |state.tia|, |state.cpu.cycle_num|, and
+  // |controls| before calling power_on().
+  Console(std::shared_ptr<const RomImage> rom, const Controls &controls);
+
+  // Plugs everything into the bus and starts the CPU from the reset vector.
+  void power_on();
+
+  // A frame is about 20000 CPU cycles. A game that goes this long without a
+  // VSYNC is stuck.
+  const static uint64_t max_frame_cycles = 100 * 20000;
+
+  // Runs until the electron gun finishes the current frame, or the CPU stops.
+  // Returns false if the frame still hadn't finished after |max_frame_cycles|.
+  bool run_frame();
+
+  // The whole machine between two instructions. It doesn't hold any pointers,
+  // so it can be copied around as plain bytes, shared between consoles
+  // running the same game, or written to disk.
+  struct Snapshot {
+    State state;
+    TIA::Snapshot tia;
+    bool should_execute;
+  };
+  // Call these between run_frame() calls, on a powered on console whose TIA
+  // draws on this thread. A snapshot can only be loaded into a console
+  // running the same cartridge. The controls aren't part of it.
+  void save_state(Snapshot &snapshot);
+  void load_state(const Snapshot &snapshot);
+};
+
+#endif
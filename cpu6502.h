@@ -0,0 +1,1171 @@
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "disasm.h"
+#include "opcodes.h"
+
+#ifndef CPU6502_H
+#define CPU6502_H
+
+#define PAGE_SIZE 0x100
+
+// A 6502 core that can be reused in any 6502 system. Everything outside the
+// processor is reached through |Bus|, which is a template parameter rather than
+// a virtual interface so that memory accesses inline straight into the
+// instructions. A Bus needs to provide:
+//
+//   uint8_t read_byte(uint16_t addr);
+//   void write_byte(uint16_t addr, uint8_t val);
+//
+//   // Whether reading |addr| does anything besides return a value, such as
+//   // switching banks. The instruction cache won't read these addresses ahead
+//   // of time.
+//   bool has_side_effect(uint16_t addr);
+//
+//   // Whether the page containing |addr| has been written to since it was
+//   // last marked clean, in which case any instructions cached from it are
+//   // stale.
+//   bool is_dirty_page(uint16_t addr);
+//   void mark_page_clean(uint16_t addr);
+//
+//   // Called on unrecoverable errors, after the core has dumped its
+//   // registers and stopped executing. It may exit, or return and leave the
+//   // core stopped.
+//   void panic();
+//
+//   // Instructions decoded ahead of time by decode_code() for the page
+//   // containing |addr|, for code that never changes, like ROM. Null if the
+//   // core should decode the page itself. Asked again whenever the page is
+//   // dirty, and pages from here are never written to, so many cores can
+//   // share them.
+//   const typename Cpu6502<Bus>::CachedInsn *shared_code(uint16_t addr);
+//
+// example_bus.cc has about the smallest Bus possible.
+//
+// The registers live outside the core, wherever the system keeps the rest of
+// its state, so a whole machine can sit in one block of plain bytes.
+struct Cpu6502Registers {
+  // Not a real register, just here to help us with cycle accurate timing
+  uint64_t cycle_num = 0;
+  uint16_t program_counter = 0;
+  uint8_t acc = 0;
+  uint8_t index_x = 0;
+  uint8_t index_y = 0;
+  uint8_t flags = 0;
+  uint8_t stack_pointer = 0xFF;
+  uint8_t padding = 0;
+};
+
+template <class Bus> class Cpu6502 {
+public:
+  Cpu6502Registers &regs;
+
+  // Flag to tell the emulator when to stop. In silicon, the machine always ran
+  // from power on, but for emulation sake we stop the program when we detect a
+  // BRK with no IRQ vector set. Another thread may clear it to stop emulation,
+  // so it has to be atomic.
+  std::atomic<bool> should_execute{false};
+
+  Bus &bus;
+
+  // A pre-parsed instruction. Not quite a JIT, but, sorta similar in concept.
+  struct CachedInsn {
+    // Runs the instruction. Null if nothing is cached at this address.
+    void (*exec)(Cpu6502 &cpu, const CachedInsn &insn);
+    // The bytes following the opcode, little endian. Whether either of them
+    // is actually part of the instruction depends on the addressing mode.
+    uint16_t operand;
+  };
+
+  Cpu6502(Bus &bus, Cpu6502Registers &regs) : regs(regs), bus(bus) {
+    regs = Cpu6502Registers();
+    std::fill(std::begin(code_pages), std::end(code_pages), no_code);
+  }
+
+  // Puts the registers in their power on state, with execution starting at
+  // |entry_point|, and forgets any cached instructions.
+  void reset(uint16_t entry_point) {
+    regs.acc = 0;
+    regs.index_x = 0;
+    regs.index_y = 0;
+    regs.flags = 0b00000000;
+    regs.stack_pointer = 255;
+    regs.program_counter = entry_point;
+    regs.cycle_num = 0;
+
+    for (int page = 0; page < 0x10000; page += PAGE_SIZE)
+      invalidate_page(page);
+  }
+
+  // Executes the instruction located at |program_counter|
+  void execute_next_insn() {
+    uint16_t pc = regs.program_counter;
+    if (bus.is_dirty_page(pc))
+      invalidate_page(pc);
+
+    const CachedInsn *insn = &code_pages[pc >> 8][pc & (PAGE_SIZE - 1)];
+    if (!insn->exec) {
+      insn = parse_page(pc);
+      // Only if the opcode was invalid, and the bus didn't exit on panic.
+      if (!insn)
+        return;
+    }
+
+    insn->exec(*this, *insn);
+  }
+
+  // Decodes an instruction at every one of the |size| bytes of |code|, into
+  // |insns|, for a Bus to hand out through shared_code(). Operands that run
+  // off the end read as zero. Invalid opcodes are left null, and only panic
+  // if they're actually run.
+  static void decode_code(const uint8_t *code, int size, CachedInsn *insns) {
+    for (int i = 0; i < size; i++) {
+      uint8_t low = i + 1 < size ? code[i + 1] : 0;
+      uint8_t high = i + 2 < size ? code[i + 2] : 0;
+      insns[i].exec = get_exec(code[i]);
+      insns[i].operand = high << 8 | low;
+    }
+  }
+
+  // Print the instruction at |program_counter| to STDOUT
+  void disasm_curr_insn() {
+    std::string disasm =
+        disasm_insn(regs.program_counter, peek_byte(regs.program_counter),
+                    peek_byte(regs.program_counter + 1),
+                    peek_byte(regs.program_counter + 2));
+
+    if (!disasm.length()) {
+      printf("<Invalid Instruction>\n");
+    } else {
+      printf("%x\t%s\n", regs.program_counter, disasm.c_str());
+    }
+  }
+
+  void dump_regs() {
+    printf("A: %02x\n", regs.acc);
+    printf("X: %02x\n", regs.index_x);
+    printf("Y: %02x\n", regs.index_y);
+    printf("Flags: %s\n", flags_to_string().c_str());
+    printf("SP: %02x\n", regs.stack_pointer);
+    printf("PC: %02x\n", regs.program_counter);
+    printf("Cycle: %lu\n", regs.cycle_num);
+    printf("\n");
+  }
+
+  void panic() {
+    should_execute = false;
+    printf("Unrecoverable error!\n");
+    dump_regs();
+    bus.panic();
+  }
+
+  uint16_t read_word(uint16_t addr) {
+    uint16_t ret = bus.read_byte(addr + 1);
+    ret = (ret << 8) | bus.read_byte(addr);
+    return ret;
+  }
+
+  void write_word(uint16_t addr, uint16_t val) {
+    bus.write_byte(addr, val & 0xFF);
+    bus.write_byte(addr + 1, val >> 8);
+  }
+
+  bool get_negative() { return regs.flags & negative_flag; }
+  void set_negative(bool val) { set_flag(negative_flag, val); }
+  bool get_overflow() { return regs.flags & overflow_flag; }
+  void set_overflow(bool val) { set_flag(overflow_flag, val); }
+  bool get_break() { return regs.flags & break_flag; }
+  void set_break(bool val) { set_flag(break_flag, val); }
+  bool get_decimal() { return regs.flags & decimal_flag; }
+  void set_decimal(bool val) { set_flag(decimal_flag, val); }
+  bool get_interrupt_enable() { return regs.flags & interrupt_enable_flag; }
+  void set_interrupt_enable(bool val) {
+    set_flag(interrupt_enable_flag, val);
+  }
+  bool get_zero() { return regs.flags & zero_flag; }
+  void set_zero(bool val) { set_flag(zero_flag, val); }
+  bool get_carry() { return regs.flags & carry_flag; }
+  void set_carry(bool val) { set_flag(carry_flag, val); }
+
+private:
+  static const uint8_t negative_flag = 0x80;
+  static const uint8_t overflow_flag = 0x40;
+  static const uint8_t break_flag = 0x10;
+  static const uint8_t decimal_flag = 0x08;
+  static const uint8_t interrupt_enable_flag = 0x04;
+  static const uint8_t zero_flag = 0x02;
+  static const uint8_t carry_flag = 0x01;
+
+  static const uint16_t stack_page = 0x100;
+  static const uint16_t irq_vector_addr = 0xFFFE;
+
+  void set_flag(uint8_t flag, bool val) {
+    if (val) {
+      regs.flags |= flag;
+    } else {
+      regs.flags = (regs.flags & (~flag));
+    }
+  }
+
+  std::string flags_to_string() {
+    std::string ret = "";
+    if (get_negative())
+      ret += "NEGATIVE | ";
+    if (get_overflow())
+      ret += "OVERFLOW | ";
+    if (get_break())
+      ret += "BREAK | ";
+    if (get_decimal())
+      ret += "DECIMAL | ";
+    if (get_interrupt_enable())
+      ret += "INTERRUPT_ENABLE | ";
+    if (get_zero())
+      ret += "ZERO | ";
+    if (get_carry())
+      ret += "CARRY | ";
+    if (ret.length())
+      return ret.substr(0, ret.length() - 3);
+    return "";
+  }
+
+  void push_byte(uint8_t val) {
+    // Note that the stack pointer might take us out of the designated stack
+    // segment
+    bus.write_byte(stack_page + regs.stack_pointer, val);
+    regs.stack_pointer--;
+  }
+
+  uint8_t pop_byte() {
+    regs.stack_pointer++;
+    return bus.read_byte(stack_page + regs.stack_pointer);
+  }
+
+  void push_word(uint16_t val) {
+    push_byte(val >> 8);
+    push_byte(val & 0xFF);
+  }
+
+  uint16_t pop_word() {
+    uint16_t byte1 = pop_byte();
+    uint16_t byte2 = pop_byte();
+
+    return byte1 | (byte2 << 8);
+  }
+
+  // Don't accidentally trigger a side effect
+  uint8_t peek_byte(uint16_t addr) {
+    return bus.has_side_effect(addr) ? 0 : bus.read_byte(addr);
+  }
+
+  /////////////////////////
+  // Instruction caching //
+  /////////////////////////
+
+  typedef void (*ExecFunc)(Cpu6502 &cpu, const CachedInsn &insn);
+
+  // Decoded instructions for every page, indexed by the low byte of the
+  // address. Pages the bus shares point straight at its copy. The rest point
+  // at |no_code| until something on them runs, and then at |private_code|,
+  // which we fill in ourselves as we go.
+  const CachedInsn *code_pages[0x100];
+  bool shared_pages[0x100] = {false};
+  std::unique_ptr<CachedInsn[]> private_code[0x100];
+  inline static const CachedInsn no_code[PAGE_SIZE] = {};
+
+  // Cache a single instruction at the given address
+  int cache_insn(uint16_t addr, bool should_succeed) {
+    // This scenario can happen if we previously cache a series of
+    // instructions and then jumped to a location earlier in the program. If
+    // that's the case, the instruction cache should already be full for the
+    // rest of the page, so we can stop parsing.
+    CachedInsn &insn = private_code[addr >> 8][addr & (PAGE_SIZE - 1)];
+    if (insn.exec)
+      return -1;
+
+    uint8_t opcode = peek_byte(addr);
+    ExecFunc exec = get_exec(opcode);
+    if (!exec) {
+      if (should_succeed) {
+        printf("Error! Invalid opcode %x\n", opcode);
+        panic();
+      }
+      return -1;
+    }
+
+    // Note we don't always need both bytes depending on the specific
+    // instruction.
+    insn.exec = exec;
+    insn.operand = peek_byte(addr + 2) << 8 | peek_byte(addr + 1);
+
+    return insn_len(addressing_mode(opcode));
+  }
+
+  // Parse from |addr| until the end of the page |addr| is located in. Returns
+  // the instruction at |addr|, or null if it's invalid.
+  const CachedInsn *parse_page(uint32_t addr) {
+    int index = addr >> 8;
+    if (shared_pages[index]) {
+      // Shared pages come decoded in full, so there's no instruction here.
+      printf("Error! Invalid opcode %x\n", peek_byte(addr));
+      panic();
+      return nullptr;
+    }
+    if (!private_code[index]) {
+      private_code[index] = std::make_unique<CachedInsn[]>(PAGE_SIZE);
+      code_pages[index] = private_code[index].get();
+    }
+
+    uint32_t page = addr & (~(PAGE_SIZE - 1));
+    const CachedInsn *insn = &code_pages[index][addr - page];
+    addr += cache_insn(addr, true);
+    while (addr < page + PAGE_SIZE) {
+      // The rest of the page may contain code, or it may contain data.
+      // We should only crash if the current instruction is invalid, not if
+      // there just happens to be invalid instruction data elsewhere in the
+      // page.
+      int insn_len = cache_insn(addr, false);
+      if (insn_len < 0)
+        break;
+      addr += insn_len;
+    }
+
+    return insn->exec ? insn : nullptr;
+  }
+
+  // In the event of self modifying code, this method will invalidate our
+  // instruction cache for the entire page. It also picks up whatever the bus
+  // is sharing for the page now, e.g. after a bank switch.
+  void invalidate_page(uint16_t page) {
+    page = page & (~(PAGE_SIZE - 1));
+    int index = page >> 8;
+
+    const CachedInsn *shared = bus.shared_code(page);
+    shared_pages[index] = shared;
+    if (shared) {
+      code_pages[index] = shared;
+    } else if (private_code[index]) {
+      std::fill(&private_code[index][0], &private_code[index][PAGE_SIZE],
+                CachedInsn());
+      code_pages[index] = private_code[index].get();
+    } else {
+      code_pages[index] = no_code;
+    }
+
+    bus.mark_page_clean(page);
+  }
+
+  // Every valid opcode gets its own instantiation of exec(), so both the
+  // operation and the addressing mode are known at compile time.
+  template <int... opcodes>
+  static const ExecFunc *exec_table(std::integer_sequence<int, opcodes...>) {
+    static const ExecFunc table[] = {
+        (opcode_ops[opcodes] == Op::invalid ? nullptr : &exec<opcodes>)...};
+    return table;
+  }
+
+  static ExecFunc get_exec(uint8_t opcode) {
+    return exec_table(std::make_integer_sequence<int, 256>())[opcode];
+  }
+
+  template <int opcode>
+  static void exec(Cpu6502 &cpu, const CachedInsn &insn) {
+    cpu.execute<opcode>(insn);
+  }
+
+  template <int opcode> void execute(const CachedInsn &insn) {
+    constexpr Mode mode = addressing_mode(opcode);
+
+    // Note that we try to increment the cycle counter before evaluating the
+    // operand to accurately read timers
+    regs.cycle_num += cycle_penalty<mode, always_extra_cycle(opcode)>(insn);
+
+    // The opcode is a constant, so this switch folds down to a single case.
+    switch (opcode_ops[opcode]) {
+    case Op::invalid:
+      break;
+    case Op::ADC:
+      _adc<mode>(insn);
+      break;
+    case Op::AND:
+      _and<mode>(insn);
+      break;
+    case Op::ASL_ACC:
+      regs.acc = left_shift(regs.acc);
+      break;
+    case Op::ASL_MEMORY:
+      _asl_memory<mode>(insn);
+      break;
+    case Op::BCC:
+      branch<mode>(!get_carry(), insn);
+      break;
+    case Op::BCS:
+      branch<mode>(get_carry(), insn);
+      break;
+    case Op::BEQ:
+      branch<mode>(get_zero(), insn);
+      break;
+    case Op::BIT:
+      _bit<mode>(insn);
+      break;
+    case Op::BMI:
+      branch<mode>(get_negative(), insn);
+      break;
+    case Op::BNE:
+      branch<mode>(!get_zero(), insn);
+      break;
+    case Op::BPL:
+      branch<mode>(!get_negative(), insn);
+      break;
+    case Op::BRK:
+      _brk<mode>();
+      break;
+    case Op::BVC:
+      branch<mode>(!get_overflow(), insn);
+      break;
+    case Op::BVS:
+      branch<mode>(get_overflow(), insn);
+      break;
+    case Op::CLC:
+      _clc();
+      break;
+    case Op::CLD:
+      _cld();
+      break;
+    case Op::CLI:
+      _cli();
+      break;
+    case Op::CLV:
+      _clv();
+      break;
+    case Op::CMP:
+      compare<mode>(regs.acc, insn);
+      break;
+    case Op::CPX:
+      compare<mode>(regs.index_x, insn);
+      break;
+    case Op::CPY:
+      compare<mode>(regs.index_y, insn);
+      break;
+    case Op::DEC:
+      _dec<mode>(insn);
+      break;
+    case Op::DEX:
+      _dex();
+      break;
+    case Op::DEY:
+      _dey();
+      break;
+    case Op::EOR:
+      _eor<mode>(insn);
+      break;
+    case Op::INC:
+      _inc<mode>(insn);
+      break;
+    case Op::INX:
+      _inx();
+      break;
+    case Op::INY:
+      _iny();
+      break;
+    case Op::JMP:
+      _jmp<mode>(insn);
+      break;
+    case Op::JSR:
+      _jsr<mode>(insn);
+      break;
+    case Op::LDA:
+      regs.acc = load_register<mode>(insn);
+      break;
+    case Op::LDX:
+      regs.index_x = load_register<mode>(insn);
+      break;
+    case Op::LDY:
+      regs.index_y = load_register<mode>(insn);
+      break;
+    case Op::LSR_ACC:
+      regs.acc = right_shift(regs.acc);
+      break;
+    case Op::LSR_MEMORY:
+      _lsr_memory<mode>(insn);
+      break;
+    case Op::NOP:
+      regs.cycle_num += 2;
+      break;
+    case Op::ORA:
+      _ora<mode>(insn);
+      break;
+    case Op::PHA:
+      _pha();
+      break;
+    case Op::PHP:
+      _php();
+      break;
+    case Op::PLA:
+      _pla();
+      break;
+    case Op::PLP:
+      _plp();
+      break;
+    case Op::ROL_ACC:
+      regs.acc = rotate_left(regs.acc);
+      break;
+    case Op::ROL_MEMORY:
+      _rol_memory<mode>(insn);
+      break;
+    case Op::ROR_ACC:
+      regs.acc = rotate_right(regs.acc);
+      break;
+    case Op::ROR_MEMORY:
+      _ror_memory<mode>(insn);
+      break;
+    case Op::RTI:
+      _rti<mode>();
+      break;
+    case Op::RTS:
+      _rts<mode>();
+      break;
+    case Op::SBC:
+      _sbc<mode>(insn);
+      break;
+    case Op::SEC:
+      _sec();
+      break;
+    case Op::SED:
+      _sed();
+      break;
+    case Op::SEI:
+      _sei();
+      break;
+    case Op::STA:
+      store<mode>(insn, regs.acc);
+      break;
+    case Op::STX:
+      store<mode>(insn, regs.index_x);
+      break;
+    case Op::STY:
+      store<mode>(insn, regs.index_y);
+      break;
+    case Op::TAX:
+      regs.index_x = transfer(regs.acc);
+      break;
+    case Op::TAY:
+      regs.index_y = transfer(regs.acc);
+      break;
+    case Op::TSX:
+      regs.index_x = transfer(regs.stack_pointer);
+      break;
+    case Op::TXA:
+      regs.acc = transfer(regs.index_x);
+      break;
+    case Op::TXS:
+      regs.stack_pointer = transfer(regs.index_x);
+      break;
+    case Op::TYA:
+      regs.acc = transfer(regs.index_y);
+      break;
+    }
+
+    regs.program_counter += insn_len(mode);
+  }
+
+  //////////////////////
+  // Addressing modes //
+  //////////////////////
+
+  template <Mode mode, bool extra_cycle>
+  int cycle_penalty(const CachedInsn &insn) {
+    uint16_t base_page = insn.operand & (~(PAGE_SIZE - 1));
+    switch (mode) {
+    case Mode::immediate:
+      return 2;
+    case Mode::zero_page:
+      return 3;
+    case Mode::zero_page_x:
+    case Mode::zero_page_y:
+      return 4;
+    case Mode::indirect:
+    case Mode::indirect_x:
+      return 6;
+    case Mode::indirect_y:
+      return extra_cycle || (insn.operand & 0xFF) + regs.index_y > PAGE_SIZE ? 6
+                                                                        : 5;
+    case Mode::absolute:
+    case Mode::absolute_jump:
+      return extra_cycle ? 5 : 4;
+    case Mode::absolute_x:
+    case Mode::absolute_y:
+      return extra_cycle || base_page != (address<mode>(insn) &
+                                          (~(PAGE_SIZE - 1)))
+                 ? 5
+                 : 4;
+    default:
+      return 0;
+    }
+  }
+
+  // The memory address the operand refers to.
+  template <Mode mode> uint16_t address(const CachedInsn &insn) {
+    switch (mode) {
+    case Mode::zero_page:
+      return insn.operand & 0xFF;
+    case Mode::zero_page_x:
+      return (insn.operand + regs.index_x) & 0xFF;
+    case Mode::zero_page_y:
+      return (insn.operand + regs.index_y) & 0xFF;
+    case Mode::absolute:
+      return insn.operand;
+    case Mode::absolute_x:
+      return insn.operand + regs.index_x;
+    case Mode::absolute_y:
+      return insn.operand + regs.index_y;
+    case Mode::absolute_jump:
+      return regs.program_counter + 1;
+    case Mode::indirect:
+      return read_word(regs.program_counter + 1);
+    case Mode::indirect_x:
+      return read_word((insn.operand + regs.index_x) & 0xFF);
+    case Mode::indirect_y:
+      return read_word(insn.operand & 0xFF) + regs.index_y;
+    default:
+      return 0;
+    }
+  }
+
+  // The value of the operand. For jumps and branches, this is where they go.
+  template <Mode mode> int load(const CachedInsn &insn) {
+    switch (mode) {
+    case Mode::invalid:
+    case Mode::implied:
+      return 0;
+    case Mode::immediate:
+      return insn.operand & 0xFF;
+    case Mode::relative:
+      // Note that relative refers to relative to the next instruction.
+      // The program counter is supposed to already be pointer there.
+      return regs.program_counter + (int8_t)(insn.operand & 0xFF) +
+             insn_len(mode);
+    case Mode::absolute_jump:
+    case Mode::indirect:
+      return read_word(address<mode>(insn));
+    default:
+      return bus.read_byte(address<mode>(insn));
+    }
+  }
+
+  template <Mode mode> void store(const CachedInsn &insn, uint8_t val) {
+    switch (mode) {
+    case Mode::invalid:
+    case Mode::implied:
+    case Mode::immediate:
+    case Mode::relative:
+    case Mode::absolute_jump:
+    case Mode::indirect:
+      printf("Error! Operand does not support set!\n");
+      panic();
+      break;
+    default:
+      bus.write_byte(address<mode>(insn), val);
+      break;
+    }
+  }
+
+  // Helper function for handling Zero and Negative flags. Note that we don't
+  // handle Carry or Overflow here because they are more complicated, and not
+  // all instructions support them.
+  void handle_arithmetic_flags(int result) {
+    set_zero(!(result & 0xFF));
+    set_negative(result & 0x80);
+  }
+
+  // Overflow is actually different from carry. It is defined as a change in
+  // sign that is *not* the intended result of the given operation. So for
+  // example, adding two positive numbers should never result in a negative
+  // number, but because our register is only 8-bit, we may overflow and get a
+  // negative anyway.
+  void handle_overflow(int val1, int val2, int result) {
+    if ((val1 & 0x80) && (val2 & 0x80) && !(result & 0x80)) {
+      set_overflow(true);
+    } else if (!(val1 & 0x80) && !(val2 & 0x80) && (result & 0x80)) {
+      set_overflow(true);
+    } else {
+      set_overflow(false);
+    }
+  }
+
+  ///////////////////////////
+  // Arithmetic Operations //
+  ///////////////////////////
+
+  // ADd with Carry. Adds the operand to the accumulator and also adds 1 to
+  // that result if the carry flag is set. Effects Negative, Overflow, Carry,
+  // and Zero
+  template <Mode mode> void _adc(const CachedInsn &insn) {
+    int val = load<mode>(insn);
+    int carry = get_carry() ? 1 : 0;
+    int result;
+    if (!get_decimal()) {
+      // Normal operation
+      result = val + regs.acc + carry;
+      set_carry(result & (~0xFF));
+    } else {
+      // Binary coded decimal mode operation. BCD can really only represent
+      // numbers 00-99. Each nibble represents a digit 0-9. Carry and Zero are
+      // set in expected ways. Negative and Overflow are also technically set,
+      // but their meaning is ambiguous and confusing in BCD mode, and are not
+      // often used.
+      int acc_digit0 = regs.acc & 0xF;
+      int acc_digit1 = regs.acc >> 4;
+      int operand_digit0 = val & 0xF;
+      int operand_digit1 = val >> 4;
+      int result_digit0 = acc_digit0 + operand_digit0 + carry;
+      carry = result_digit0 > 9;
+      result_digit0 = result_digit0 % 10;
+      int result_digit1 = acc_digit1 + operand_digit1 + carry;
+      carry = result_digit1 > 9;
+      set_carry(carry);
+      result_digit1 = result_digit1 % 10;
+      result = carry << 8 | result_digit1 << 4 | result_digit0;
+    }
+    handle_arithmetic_flags(result);
+    handle_overflow(val, regs.acc, result);
+    regs.acc = result & 0xFF;
+  }
+
+  // Note that neither increment nor decrement affect Carry or Overflow
+
+  // DECrement memory
+  // Effects Negative and Zero
+  template <Mode mode> void _dec(const CachedInsn &insn) {
+    regs.cycle_num += 2;
+
+    uint16_t addr = address<mode>(insn);
+    int result = bus.read_byte(addr) - 1;
+    handle_arithmetic_flags(result);
+    bus.write_byte(addr, result & 0xFF);
+  }
+
+  // DEcrement X
+  // Effects Negative and Zero
+  void _dex() {
+    regs.cycle_num += 2;
+
+    regs.index_x--;
+    handle_arithmetic_flags(regs.index_x);
+  }
+
+  // DEcrement Y
+  // Effects Negative and Zero
+  void _dey() {
+    regs.cycle_num += 2;
+
+    regs.index_y--;
+    handle_arithmetic_flags(regs.index_y);
+  }
+
+  // INCrement memory
+  // Effects Negative and Zero
+  template <Mode mode> void _inc(const CachedInsn &insn) {
+    regs.cycle_num += 2;
+
+    uint16_t addr = address<mode>(insn);
+    int result = bus.read_byte(addr) + 1;
+    handle_arithmetic_flags(result);
+    bus.write_byte(addr, result & 0xFF);
+  }
+
+  // INcrement X
+  // Effects Negative and Zero
+  void _inx() {
+    regs.cycle_num += 2;
+
+    regs.index_x++;
+    handle_arithmetic_flags(regs.index_x);
+  }
+
+  // INcrement Y
+  // Effects Negative and Zero
+  void _iny() {
+    regs.cycle_num += 2;
+
+    regs.index_y++;
+    handle_arithmetic_flags(regs.index_y);
+  }
+
+  // SuBtract with borrow (mnemonic is misleading)
+  // Borrow is a pseudoflag is the inverse of carry.
+  // If borrow is set, we subtract an extra 1 from our result.
+  // If our result is negative, we clear the carry flag, which is unintuitive.
+  // Effects Negative, Zero, Carry, and Overflow
+  template <Mode mode> void _sbc(const CachedInsn &insn) {
+    int val = load<mode>(insn);
+    int carry = get_carry() ? 0 : 1;
+    int result;
+    if (!get_decimal()) {
+      result = regs.acc - val - carry;
+      set_carry(!(result & (~0xFF)));
+    } else {
+      // SBC also supports a Binary Coded Decimal mode.
+      int acc_digit0 = regs.acc & 0xF;
+      int acc_digit1 = regs.acc >> 4;
+      int operand_digit0 = val & 0xF;
+      int operand_digit1 = val >> 4;
+      int result_digit0 = acc_digit0 - operand_digit0 - carry;
+      carry = result_digit0 < 0;
+      if (result_digit0 < 0)
+        result_digit0 += 10;
+      int result_digit1 = acc_digit1 - operand_digit1 - carry;
+      carry = result_digit1 < 0;
+      set_carry(!carry);
+      if (result_digit1 < 0)
+        result_digit1 += 10;
+      result = carry << 8 | result_digit1 << 4 | result_digit0;
+    }
+    handle_arithmetic_flags(result);
+    handle_overflow((-1 * val) & 0xFF, regs.acc, result);
+    regs.acc = result & 0xFF;
+  }
+
+  //////////////////////////////
+  // Bit twiddling operations //
+  //////////////////////////////
+
+  // Bitwise logical AND
+  // Effects Negative and Zero
+  template <Mode mode> void _and(const CachedInsn &insn) {
+    int result = load<mode>(insn) & regs.acc;
+    handle_arithmetic_flags(result);
+    regs.acc = result & 0xFF;
+  }
+
+  // Arithmetic Shift Left. Not actually different from a logical shift left.
+  // Most significant bit is shifted into Carry register.
+  // Effects Negative, Zero, and Carry
+  uint8_t left_shift(uint8_t input) {
+    regs.cycle_num += 2;
+
+    set_carry(input & 0x80);
+    input <<= 1;
+    handle_arithmetic_flags(input);
+
+    return input;
+  }
+
+  template <Mode mode> void _asl_memory(const CachedInsn &insn) {
+    uint16_t addr = address<mode>(insn);
+    bus.write_byte(addr, left_shift(bus.read_byte(addr)));
+  }
+
+  // Exclusive OR with accumulator
+  // Effects Negative and Carry
+  template <Mode mode> void _eor(const CachedInsn &insn) {
+    int result = load<mode>(insn) ^ regs.acc;
+    handle_arithmetic_flags(result);
+    regs.acc = result;
+  }
+
+  // Logical Shift Right one bit.
+  // Least significant bit is shifted into Carry register.
+  // Also clears Negative and effects Zero
+  uint8_t right_shift(uint8_t input) {
+    regs.cycle_num += 2;
+
+    set_carry(input & 0x01);
+    input >>= 1;
+    handle_arithmetic_flags(input);
+
+    return input;
+  }
+
+  template <Mode mode> void _lsr_memory(const CachedInsn &insn) {
+    uint16_t addr = address<mode>(insn);
+    bus.write_byte(addr, right_shift(bus.read_byte(addr)));
+  }
+
+  // Bitwise inclusive OR with Accumulator
+  // Effects Negative and Zero
+  template <Mode mode> void _ora(const CachedInsn &insn) {
+    int result = regs.acc | load<mode>(insn);
+    handle_arithmetic_flags(result);
+    regs.acc = result & 0xFF;
+  }
+
+  // ROtate Left.
+  // Shifts Carry into least significant bit and most significant bit into
+  // Carry. Also effects Negative and Zero
+  uint8_t rotate_left(uint8_t input) {
+    regs.cycle_num += 2;
+
+    bool new_carry = input & 0x80;
+
+    input <<= 1;
+    input |= get_carry();
+    handle_arithmetic_flags(input);
+    set_carry(new_carry);
+
+    return input;
+  }
+
+  template <Mode mode> void _rol_memory(const CachedInsn &insn) {
+    uint16_t addr = address<mode>(insn);
+    bus.write_byte(addr, rotate_left(bus.read_byte(addr)));
+  }
+
+  // ROtate Right.
+  // Shifts Carry into most significant bit and least significant bit into
+  // Carry. Also effects Negative and Zero
+  uint8_t rotate_right(uint8_t input) {
+    regs.cycle_num += 2;
+
+    bool new_carry = input & 0x01;
+
+    input >>= 1;
+    input |= (int)get_carry() << 7;
+    handle_arithmetic_flags(input);
+    set_carry(new_carry);
+
+    return input;
+  }
+
+  template <Mode mode> void _ror_memory(const CachedInsn &insn) {
+    uint16_t addr = address<mode>(insn);
+    bus.write_byte(addr, rotate_right(bus.read_byte(addr)));
+  }
+
+  ///////////////////////////////
+  // Control Flow Instructions //
+  ///////////////////////////////
+
+  // Note that all branch instructions add a cycle penalty for taking the
+  // branch. There's also a penalty if the branch is in a different page.
+  template <Mode mode> void branch(bool condition, const CachedInsn &insn) {
+    regs.cycle_num += 2;
+
+    if (condition) {
+      regs.cycle_num++;
+
+      uint16_t new_program_counter = load<mode>(insn) - insn_len(mode);
+      if ((new_program_counter & (~(PAGE_SIZE - 1))) !=
+          (regs.program_counter & (~(PAGE_SIZE - 1))))
+        regs.cycle_num++;
+      regs.program_counter = new_program_counter;
+    }
+  }
+
+  // Unconditional JuMP
+  template <Mode mode> void _jmp(const CachedInsn &insn) {
+    // Most cycle numbers follow a pretty predictable pattern based on the
+    // operand type. This particular instruction doesn't, so we work around
+    // that with this decrement.
+    regs.cycle_num--;
+
+    regs.program_counter = load<mode>(insn) - insn_len(mode);
+  }
+
+  // Jump to SubRoutine
+  // This is similar to the x86 "call" instruction. We push the return address
+  // onto the stack.
+  template <Mode mode> void _jsr(const CachedInsn &insn) {
+    regs.cycle_num += 2;
+
+    // A quirk in the 6502 stores return address - 1 for JSR.
+    push_word(regs.program_counter + insn_len(mode) - 1);
+    regs.program_counter = load<mode>(insn) - insn_len(mode);
+  }
+
+  // ReTurn from Interrupt
+  // Pops 1 byte into the status register, then 2 bytes into the program
+  // counter. The Atari 2600 doesn't really have hardware interrupts, but it
+  // does technically have software interrupts, so we include this just in
+  // case.
+  template <Mode mode> void _rti() {
+    regs.cycle_num += 6;
+
+    regs.flags = pop_byte();
+    regs.program_counter = pop_word() - insn_len(mode);
+  }
+
+  // ReTurn from Subroutine
+  // Pops 2 bytes into the program counter
+  template <Mode mode> void _rts() {
+    regs.cycle_num += 6;
+
+    regs.program_counter = pop_word() - insn_len(mode) + 1;
+  }
+
+  /////////////////////////////
+  // Comparison Instructions //
+  /////////////////////////////
+
+  // BIT test.
+  // Bit 7 of the operand is transferred into the Negative flag, and Bit 6 is
+  // transferred into the Overflow flag. Then the operand and the accumulator
+  // are bitwise AND'd together, and the Zero flag is set accordingly.
+  template <Mode mode> void _bit(const CachedInsn &insn) {
+    int val = load<mode>(insn);
+    set_negative(val & 0x80);
+    set_overflow(val & 0x40);
+    set_zero(!(val & regs.acc));
+  }
+
+  // CoMPare, ComPare X, and ComPare Y.
+  // Subtracts operand from the register, setting the flags appropriately, but
+  // then discard the results. Note that we don't handle overflow for CMP,
+  // unlike actual SBC.
+  template <Mode mode> void compare(uint8_t reg, const CachedInsn &insn) {
+    int result = reg - load<mode>(insn);
+    handle_arithmetic_flags(result);
+    set_carry(!(result & (~0xFF)));
+  }
+
+  ////////////////////////////////
+  // Data Transfer Instructions //
+  ////////////////////////////////
+
+  // LoaD Accumulator, LoaD X, and LoaD Y
+  // Returns the value of the operand for the register.
+  // Effects Negative and Zero
+  template <Mode mode> uint8_t load_register(const CachedInsn &insn) {
+    uint8_t val = load<mode>(insn);
+    handle_arithmetic_flags(val);
+    return val;
+  }
+
+  // Transfer instructions, e.g. TAX for Transfer Accumulator to X. Returns the
+  // value of the source register for the destination.
+  // Effects Negative and Zero
+  uint8_t transfer(uint8_t val) {
+    regs.cycle_num += 2;
+
+    handle_arithmetic_flags(val);
+    return val;
+  }
+
+  // PusH Accumulator
+  // Pushes accumulator onto the stack
+  void _pha() {
+    regs.cycle_num += 3;
+
+    push_byte(regs.acc);
+  }
+
+  // PusH flags (misleading mnemonic)
+  // Pushes flag register onto the stack and sets the break flag
+  void _php() {
+    regs.cycle_num += 3;
+
+    push_byte(regs.flags);
+    set_break(true);
+  }
+
+  // PuLl Accumulator
+  // Pops 1 byte from the stack and sets the accumulator equal to it.
+  // Effects Negative and Zero
+  void _pla() {
+    regs.cycle_num += 4;
+
+    regs.acc = pop_byte();
+    handle_arithmetic_flags(regs.acc);
+  }
+
+  // PuLl flags (misleading mnemonic)
+  // Pops 1 byte from the stack and sets the flag register to it.
+  void _plp() {
+    regs.cycle_num += 4;
+
+    regs.flags = pop_byte();
+  }
+
+  ////////////////////////////////
+  // Miscellaneous Instructions //
+  ////////////////////////////////
+
+  // BReaK
+  // Software interrupt, like "int" on x86.
+  // This will push the return address and flags register to the stack and
+  // begin executing the interrupt handler routine at the address specified in
+  // the interrupt vector address. BRK is actually a 2 byte instruction, with
+  // the second byte being ignored. This second byte is referred to as the
+  // "break mark". There's no explicit hardware support for this, but the break
+  // mark is often used to specify the syscall number in more complex 6502
+  // systems.
+  template <Mode mode> void _brk() {
+    int irq_vector = read_word(irq_vector_addr);
+
+    // Most Atari 2600 ROMs won't use interrupts at all, and will simply clear
+    // the interrupt vector. If we reach a BRK in one of these games, we should
+    // probably just end the program.
+    if (!irq_vector) {
+      should_execute = false;
+      return;
+    }
+
+    if (!get_interrupt_enable())
+      return;
+
+    regs.cycle_num += 7;
+
+    push_word(regs.program_counter + insn_len(mode) +
+              1); // Leave extra space for a break mark
+    push_byte(regs.flags);
+    regs.program_counter = irq_vector - insn_len(mode);
+    set_break(true);
+  }
+
+  // CLear Carry
+  void _clc() {
+    regs.cycle_num += 2;
+
+    set_carry(false);
+  }
+
+  // CLear Decimal
+  void _cld() {
+    regs.cycle_num += 2;
+
+    set_decimal(false);
+  }
+
+  // CLear Interrupt enable
+  void _cli() {
+    regs.cycle_num += 2;
+
+    set_interrupt_enable(false);
+  }
+
+  // CLear oVerflow
+  void _clv() {
+    regs.cycle_num += 2;
+
+    set_overflow(false);
+  }
+
+  // SEt Carry
+  void _sec() {
+    regs.cycle_num += 2;
+
+    set_carry(true);
+  }
+
+  // SEt Decimal
+  void _sed() {
+    regs.cycle_num += 2;
+
+    set_decimal(true);
+  }
+
+  // SEt Interrupt enable
+  void _sei() {
+    regs.cycle_num += 2;
+
+    set_interrupt_enable(true);
+  }
+};
+
+#endif
@@ -3,40 +3,84 @@
 #include <stdint.h>
 #include <stdio.h>
 
-#include "instructions.h"
-#include "memory.h"
-#include "operand.h"
-#include "registers.h"
+#include "opcodes.h"
 
-void disasm_curr_insn() {
-  uint8_t opcode;
-  uint8_t byte1;
-  uint8_t byte2;
+std::string mnemonics[256] = {
+    "BRK", "ORA", "",    "", "",    "ORA", "ASL", "", "PHP", "ORA", "ASL", "",
+    "",    "ORA", "ASL", "", "BPL", "ORA", "",    "", "",    "ORA", "ASL", "",
+    "CLC", "ORA", "",    "", "",    "ORA", "ASL", "", "JSR", "AND", "",    "",
+    "BIT", "AND", "ROL", "", "PLP", "AND", "ROL", "", "BIT", "AND", "ROL", "",
+    "BMI", "AND", "",    "", "",    "AND", "ROL", "", "SEC", "AND", "",    "",
+    "",    "AND", "ROL", "", "RTI", "EOR", "",    "", "",    "EOR", "LSR", "",
+    "PHA", "EOR", "LSR", "", "JMP", "EOR", "LSR", "", "BVC", "EOR", "",    "",
+    "",    "EOR", "LSR", "", "CLI", "EOR", "",    "", "",    "EOR", "LSR", "",
+    "RTS", "ADC", "",    "", "",    "ADC", "ROR", "", "PLA", "ADC", "ROR", "",
+    "JMP", "ADC", "ROR", "", "BVS", "ADC", "",    "", "",    "ADC", "ROR", "",
+    "SEI", "ADC", "",    "", "",    "ADC", "ROR", "", "",    "STA", "",    "",
+    "STY", "STA", "STX", "", "DEY", "",    "TXA", "", "STY", "STA", "STX", "",
+    "BCC", "STA", "",    "", "STY", "STA", "STX", "", "TYA", "STA", "TXS", "",
+    "",    "STA", "",    "", "LDY", "LDA", "LDX", "", "LDY", "LDA", "LDX", "",
+    "TAY", "LDA", "TAX", "", "LDY", "LDA", "LDX", "", "BCS", "LDA", "",    "",
+    "LDY", "LDA", "LDX", "", "CLV", "LDA", "TSX", "", "LDY", "LDA", "LDX", "",
+    "CPY", "CMP", "",    "", "CPY", "CMP", "DEC", "", "INY", "CMP", "DEX", "",
+    "CPY", "CMP", "DEC", "", "BNE", "CMP", "",    "", "",    "CMP", "DEC", "",
+    "CLD", "CMP", "",    "", "",    "CMP", "DEC", "", "CPX", "SBC", "",    "",
+    "CPX", "SBC", "INC", "", "INX", "SBC", "NOP", "", "CPX", "SBC", "INC", "",
+    "BEQ", "SBC", "",    "", "",    "SBC", "INC", "", "SED", "SBC", "",    "",
+    "",    "SBC", "INC", "",
+};
 
-  // Don't accidentally trigger a side effect
-  if (has_side_effect(program_counter)) {
-    opcode = 0;
-  } else {
-    opcode = read_byte(program_counter);
-  }
-  if (has_side_effect(program_counter + 1)) {
-    byte1 = 0;
-  } else {
-    byte1 = read_byte(program_counter + 1);
-  }
-  if (has_side_effect(program_counter + 2)) {
-    byte2 = 0;
-  } else {
-    byte2 = read_byte(program_counter + 2);
-  }
+std::string get_mnemonic(uint8_t opcode) { return mnemonics[opcode]; }
 
+std::string disasm_insn(uint16_t addr, uint8_t opcode, uint8_t byte1,
+                        uint8_t byte2) {
   auto mnemonic = get_mnemonic(opcode);
+  if (!mnemonic.length())
+    return mnemonic;
 
-  if (!mnemonic.length()) {
-    printf("<Invalid Instruction>\n");
-  } else {
-    auto operand = create_operand(program_counter, opcode, byte1, byte2);
-    auto disasm_string = mnemonic + "\t" + operand->to_string();
-    printf("%x\t%s\n", program_counter, disasm_string.c_str());
+  uint16_t abs_word = ((uint16_t)byte2) << 8 | byte1;
+  char buf[256];
+  switch (addressing_mode(opcode)) {
+  case Mode::relative:
+    // Relative to the next instruction.
+    snprintf(buf, 256, "0x%04x",
+             (uint16_t)(addr + (int8_t)byte1 + insn_len(Mode::relative)));
+    break;
+  case Mode::immediate:
+    snprintf(buf, 256, "#0x%04x", byte1);
+    break;
+  case Mode::zero_page:
+    snprintf(buf, 256, "0x%02x", byte1);
+    break;
+  case Mode::zero_page_x:
+    snprintf(buf, 256, "0x%02x,X", byte1);
+    break;
+  case Mode::zero_page_y:
+    snprintf(buf, 256, "0x%02x,Y", byte1);
+    break;
+  case Mode::absolute:
+  case Mode::absolute_jump:
+    snprintf(buf, 256, "0x%04x", abs_word);
+    break;
+  case Mode::absolute_x:
+    snprintf(buf, 256, "0x%04x,X", abs_word);
+    break;
+  case Mode::absolute_y:
+    snprintf(buf, 256, "0x%04x,Y", abs_word);
+    break;
+  case Mode::indirect:
+    snprintf(buf, 256, "(0x%04x)", abs_word);
+    break;
+  case Mode::indirect_x:
+    snprintf(buf, 256, "(0x%02x,X)", byte1);
+    break;
+  case Mode::indirect_y:
+    snprintf(buf, 256, "(0x%02x),Y", byte1);
+    break;
+  default:
+    buf[0] = '\0';
+    break;
   }
+
+  return mnemonic + "\t" + buf;
 }
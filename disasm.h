@@ -1,10 +1,19 @@
+#include <stdint.h>
 #include <string>
 
 #ifndef DISASM_H
 #define DISASM_H
 
-// Print the disassembly of the instruction located at |program_counter| to
-// STDOUT.
-void disasm_curr_insn();
+// The 6502 disassembler. This doesn't depend on the rest of the system, so it
+// takes the instruction bytes rather than reading them from memory.
+
+// Disassembles the instruction at |addr| made up of |opcode|, |byte1|, and
+// |byte2|. Bytes past the end of the instruction are ignored. Returns an empty
+// string if |opcode| isn't a valid instruction.
+std::string disasm_insn(uint16_t addr, uint8_t opcode, uint8_t byte1,
+                        uint8_t byte2);
+
+// The mnemonic for |opcode|, or an empty string if it isn't valid.
+std::string get_mnemonic(uint8_t opcode);
 
 #endif
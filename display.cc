@@ -1,7 +1,21 @@
 #include "display.h"
 
+#include <QCoreApplication>
+#include <QGuiApplication>
+#include <QScreen>
+
 #include "qt_display.h"
 
 std::unique_ptr<Display> create_display(int width, int height, int scale) {
   return std::make_unique<QtDisplay>(width, height, scale);
 }
+
+void request_quit() {
+  QMetaObject::invokeMethod(QCoreApplication::instance(), "quit",
+                            Qt::QueuedConnection);
+}
+
+double host_refresh_hz() {
+  QScreen *screen = QGuiApplication::primaryScreen();
+  return screen ? screen->refreshRate() : 0;
+}
@@ -15,10 +15,19 @@ public:
   // TODO: Support PAL and SECAM color palettes.
   uint8_t *framebuf;
 
-  // Display the information in the current framebuffer.
+  // Display the information in the current framebuffer. Displays are free to
+  // point |framebuf| at a different buffer afterwards, and its contents are
+  // undefined until the next frame is drawn.
   virtual void swap_buf() = 0;
 };
 
 std::unique_ptr<Display> create_display(int width, int height, int scale);
 
+// Ask the frontend's event loop to exit. Safe to call from any thread.
+void request_quit();
+
+// The host display's refresh rate in Hz, or 0 if we can't tell. Call this from
+// the main thread.
+double host_refresh_hz();
+
 #endif
@@ -0,0 +1,123 @@
+#include "env.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Only ever draws into the caller's buffers, but the NTSC clears the
+// framebuffer when it starts up, so it needs one of its own to begin with.
+class EnvDisplay : public Display {
+  uint8_t buf[Env::frame_size];
+
+public:
+  EnvDisplay() { framebuf = buf; }
+
+  void swap_buf() override {}
+};
+
+Env::Env(std::shared_ptr<const RomImage> rom,
+         const std::vector<uint16_t> &score_addrs)
+    : rom(rom), score_addrs(score_addrs) {
+  for (uint16_t addr : score_addrs) {
+    if (addr < RAM_START || addr > RAM_END) {
+      printf("Error! Score address %x is not in RAM\n", addr);
+      exit(-1);
+    }
+  }
+
+  reset();
+}
+
+void Env::reset() {
+  controls = Controls();
+
+  // Loading a start state puts back everything, so the console only needs
+  // building the first time.
+  if (!console || !start_state) {
+    console = std::make_unique<Console>(rom, controls);
+    auto env_display = std::make_unique<EnvDisplay>();
+    display = env_display.get();
+    console->tia =
+        std::make_unique<TIA>(console->state.tia, console->state.cpu.cycle_num,
+                              controls, std::move(env_display));
+    console->power_on();
+  }
+  if (start_state)
+    console->load_state(*start_state);
+
+  // Same starting point every episode, even if the first step only draws one
+  // frame to pool.
+  for (std::vector<uint8_t> &pool_frame : pool_frames)
+    std::fill(pool_frame.begin(), pool_frame.end(), 0);
+
+  score = read_score();
+}
+
+void Env::start_from(const std::vector<uint8_t> &inputs, uint64_t frames,
+                     const char *cache_dir) {
+  start_state = find_start_state(rom, inputs, frames, cache_dir);
+}
+
+void Env::preprocess(int width, int height) {
+  preprocessor = std::make_unique<Preprocessor>(width, height);
+  for (std::vector<uint8_t> &pool_frame : pool_frames)
+    pool_frame.assign(frame_size, 0);
+}
+
+int Env::observation_size() {
+  return preprocessor ? preprocessor->observation_size() : frame_size;
+}
+
+int64_t Env::read_score() {
+  const uint8_t *ram = console->bus.get_ram();
+  int64_t ret = 0;
+  for (uint16_t addr : score_addrs) {
+    uint8_t bcd = ram[addr - RAM_START];
+    ret = ret * 100 + (bcd >> 4) * 10 + (bcd & 0x0F);
+  }
+  return ret;
+}
+
+int64_t Env::step(uint8_t action, int frameskip, uint8_t *frame,
+                  uint8_t *ram) {
+  controls.set_joystick(0, action);
+
+  // Preprocessing pools the last two frames, so both get drawn.
+  int drawn_frames = preprocessor ? 2 : 1;
+  for (int i = 0; i < frameskip && !done(); i++) {
+    bool drawing = frame && i >= frameskip - drawn_frames;
+    if (drawing && preprocessor) {
+      newest ^= 1;
+      display->framebuf = pool_frames[newest].data();
+    } else if (drawing) {
+      display->framebuf = frame;
+    }
+    console->tia->set_drawing(drawing);
+    console->run_frame();
+  }
+
+  if (frame && preprocessor) {
+    preprocessor->process(pool_frames[newest].data(),
+                          pool_frames[newest ^ 1].data(), frame);
+  }
+
+  if (ram)
+    memcpy(ram, console->bus.get_ram(), ram_size);
+
+  int64_t old_score = score;
+  score = read_score();
+  return score - old_score;
+}
+
+void step_batch(ThreadPool &pool, Env *const *envs, int count,
+                const uint8_t *actions, int frameskip, int64_t *rewards,
+                uint8_t *frames, uint8_t *rams) {
+  pool.for_each(count, [&](int i) {
+    size_t frame_offset = (size_t)i * envs[i]->observation_size();
+    rewards[i] =
+        envs[i]->step(actions[i], frameskip,
+                      frames ? frames + frame_offset : nullptr,
+                      rams ? rams + (size_t)i * Env::ram_size : nullptr);
+  });
+}
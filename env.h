@@ -0,0 +1,103 @@
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "atari.h"
+#include "bank_switchers.h"
+#include "console.h"
+#include "display.h"
+#include "input.h"
+#include "ntsc.h"
+#include "preprocess.h"
+#include "start_states.h"
+#include "thread_pool.h"
+
+#ifndef ENV_H
+#define ENV_H
+
+// A console wrapped up as a reinforcement learning environment. There's no
+// window, no sound, and no pacing, and frames are drawn straight into the
+// caller's buffers rather than into a framebuffer of our own. Environments
+// don't share any state, so a whole batch of them can be stepped at once on a
+// thread pool with step_batch().
+class Env {
+  // Shared with every other environment running the same game.
+  std::shared_ptr<const RomImage> rom;
+
+  // RAM addresses of the score, most significant byte first. Games nearly
+  // always keep it in BCD.
+  std::vector<uint16_t> score_addrs;
+  int64_t score = 0;
+
+  // Where episodes start, if not from power on. See start_from().
+  std::shared_ptr<const Console::Snapshot> start_state;
+
+  Controls controls;
+  std::unique_ptr<Console> console;
+  // The TIA's display. We just point its framebuffer at whatever the caller
+  // wants the frame drawn into.
+  Display *display;
+
+  // Set if we're handing back observations rather than whole frames. The
+  // last two frames are drawn into |pool_frames| to be pooled, alternating
+  // between them, and |newest| is the one drawn last.
+  std::unique_ptr<Preprocessor> preprocessor;
+  std::vector<uint8_t> pool_frames[2];
+  int newest = 0;
+
+  int64_t read_score();
+
+public:
+  const static int frame_size =
+      NTSC::visible_columns * NTSC::visible_scanlines;
+  const static int ram_size = RAM_END - RAM_START + 1;
+
+  Env(std::shared_ptr<const RomImage> rom,
+      const std::vector<uint16_t> &score_addrs);
+
+  // The console holds on to |controls|, so an Env can't be copied.
+  Env(const Env &) = delete;
+  Env &operator=(const Env &) = delete;
+
+  // Starts a new episode, by power cycling the console, or by loading the
+  // start state if there is one.
+  void reset();
+
+  // From the next reset() on, episodes start |frames| frames after power on,
+  // with player 0's joystick held at |inputs|[i] on frame i while booting.
+  // The state there is only worked out once per process and shared by every
+  // environment starting from it, and if |cache_dir| is set, it's saved there
+  // for next time. See find_start_state().
+  void start_from(const std::vector<uint8_t> &inputs, uint64_t frames,
+                  const char *cache_dir = nullptr);
+
+  // From now on, step() hands back |width| x |height| grayscale observations
+  // made from the last two frames of the step, instead of whole frames. With
+  // a frameskip of 1, the last frame of the step before stands in for the
+  // first. See Preprocessor.
+  void preprocess(int width, int height);
+
+  // How many bytes step() puts in |frame|, frame_size unless preprocessing.
+  int observation_size();
+
+  // Holds down |action|, the Controls::joystick_* bits for player 0, for
+  // |frameskip| frames, and returns how much the score went up. If |frame| is
+  // set, the last of those frames is drawn into it as frame_size palette
+  // indices, and the rest aren't drawn at all. Anything the game doesn't draw,
+  // e.g. because it cut the frame short, is left alone. If |ram| is set, RAM
+  // is copied into it as of the end of the step.
+  int64_t step(uint8_t action, int frameskip, uint8_t *frame, uint8_t *ram);
+
+  // Whether the CPU has stopped, in which case stepping does nothing.
+  bool done() { return !console->cpu.should_execute; }
+};
+
+// Steps |envs|[i] with |actions|[i] for every i below |count|, spread across
+// |pool|, and puts the rewards in |rewards|. |frames| and |rams| are optional,
+// and hold observation_size() and Env::ram_size bytes for each environment.
+// Every environment has to be preprocessing the same way, or not at all.
+void step_batch(ThreadPool &pool, Env *const *envs, int count,
+                const uint8_t *actions, int frameskip, int64_t *rewards,
+                uint8_t *frames, uint8_t *rams);
+
+#endif
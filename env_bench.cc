@@ -0,0 +1,245 @@
+// Steps a batch of RL environments with random actions as fast as it can, and
+// reports how many environment steps per second that comes to. Also a small
+// example of using env.h.
+
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "bank_switchers.h"
+#include "env.h"
+#include "frame_stats.h"
+#include "movie.h"
+#include "thread_pool.h"
+
+void print_usage_and_exit() {
+  printf("Usage: env_bench [-n envs] [-j threads] [-s steps] [-k frameskip] "
+         "[-o] [-g WxH] [-v isa] [-e steps] [-p frames] [-m movie] [-c dir] "
+         "[-b bankswitch] [-a score_addrs] <program_file>\n");
+  printf("-n: Number of environments. Default is 64.\n");
+  printf("-j: Number of threads, 0 for one pinned to each physical core.\n");
+  printf("    Default is 0.\n");
+  printf("-s: Steps to run every environment for. Default is 1000.\n");
+  printf("-k: Frames per step. Default is 4.\n");
+  printf("-o: Draw a frame for every step, like an agent that watches the\n");
+  printf("    screen. Otherwise only RAM is observed.\n");
+  printf("-g: Observe WxH grayscale frames, e.g. 84x84, pooled over the last\n");
+  printf("    two frames of every step, instead of whole frames. Implies -o.\n");
+  printf("-v: Vector instructions to preprocess -g observations with, avx2,\n");
+  printf("    sse4.1, or none. Default is the best the host supports.\n");
+  printf("-e: Reset every environment after this many steps. Default is\n");
+  printf("    to never reset.\n");
+  printf("-p: Start episodes this many frames after power on, from a start\n");
+  printf("    state shared by every environment.\n");
+  printf("-m: Play player 0's input from the given movie while booting up to\n");
+  printf("    the start state. Without -p, the start is where it runs out.\n");
+  printf("-c: Save start states to the given directory, and load them from\n");
+  printf("    there next time.\n");
+  printf("-b: Select bankswitch mode, as with check2600.\n");
+  printf("-a: Comma separated hex RAM addresses of the score, most\n");
+  printf("    significant first.\n");
+  printf("-h: Show this help menu and exit.\n");
+  exit(0);
+}
+
+uint64_t hash_bytes(const std::vector<uint8_t> &bytes) {
+  uint64_t hash = 0xcbf29ce484222325;
+  for (uint8_t byte : bytes) {
+    hash ^= byte;
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+int main(int argc, char **argv) {
+  int num_envs = 64;
+  int num_threads = 0;
+  int steps = 1000;
+  int frameskip = 4;
+  bool observe_frames = false;
+  bool preprocess_frames = false;
+  int obs_width = 0;
+  int obs_height = 0;
+  PreprocessIsa preprocess_isa = preprocess_avx2;
+  int episode_steps = 0;
+  int64_t start_frames = -1;
+  const char *movie_filename = nullptr;
+  const char *cache_dir = nullptr;
+  BankSwitcherType bank_switcher_type = BankSwitcherType::none;
+  std::vector<uint16_t> score_addrs;
+
+  int c;
+  while ((c = getopt(argc, argv, "hn:j:s:k:og:v:e:p:m:c:b:a:")) != -1) {
+    switch (c) {
+    case 'h':
+      print_usage_and_exit();
+      break;
+    case 'n':
+      num_envs = atoi(optarg);
+      if (num_envs <= 0) {
+        printf("Error! Invalid number of environments %s\n", optarg);
+        exit(-1);
+      }
+      break;
+    case 'j':
+      num_threads = atoi(optarg);
+      if (num_threads < 0) {
+        printf("Error! Invalid number of threads %s\n", optarg);
+        exit(-1);
+      }
+      break;
+    case 's':
+      steps = atoi(optarg);
+      if (steps <= 0) {
+        printf("Error! Invalid number of steps %s\n", optarg);
+        exit(-1);
+      }
+      break;
+    case 'k':
+      frameskip = atoi(optarg);
+      if (frameskip <= 0) {
+        printf("Error! Invalid frameskip %s\n", optarg);
+        exit(-1);
+      }
+      break;
+    case 'o':
+      observe_frames = true;
+      break;
+    case 'g':
+      if (sscanf(optarg, "%dx%d", &obs_width, &obs_height) != 2) {
+        printf("Error! Invalid observation size %s\n", optarg);
+        exit(-1);
+      }
+      observe_frames = true;
+      preprocess_frames = true;
+      break;
+    case 'v':
+      if (!parse_preprocess_isa(optarg, preprocess_isa)) {
+        printf("Error! Invalid instruction set %s\n", optarg);
+        exit(-1);
+      }
+      break;
+    case 'e':
+      episode_steps = atoi(optarg);
+      if (episode_steps <= 0) {
+        printf("Error! Invalid episode length %s\n", optarg);
+        exit(-1);
+      }
+      break;
+    case 'p':
+      start_frames = atoll(optarg);
+      if (start_frames < 0) {
+        printf("Error! Invalid start frame %s\n", optarg);
+        exit(-1);
+      }
+      break;
+    case 'm':
+      movie_filename = optarg;
+      break;
+    case 'c':
+      cache_dir = optarg;
+      break;
+    case 'b':
+      if (!parse_bank_switcher_type(optarg, bank_switcher_type)) {
+        printf("Error! Invalid bankswitch type %s\n", optarg);
+        exit(-1);
+      }
+      break;
+    case 'a':
+      for (char *addr = strtok(optarg, ","); addr; addr = strtok(nullptr, ","))
+        score_addrs.push_back(strtoul(addr, nullptr, 16));
+      break;
+    default:
+      print_usage_and_exit();
+    }
+  }
+
+  if (optind != argc - 1)
+    print_usage_and_exit();
+
+  std::shared_ptr<const RomImage> rom =
+      read_rom(argv[optind], bank_switcher_type);
+  limit_preprocess_isa(preprocess_isa);
+
+  std::vector<uint8_t> start_inputs;
+  if (movie_filename) {
+    Movie movie(movie_filename, false);
+    Controls movie_controls;
+    while (movie.next_frame(movie_controls))
+      start_inputs.push_back(movie_controls.get_joystick(0));
+    if (start_frames < 0)
+      start_frames = start_inputs.size();
+  }
+  bool use_start_state = start_frames >= 0;
+
+  std::vector<std::unique_ptr<Env>> env_storage;
+  std::vector<Env *> envs;
+  for (int i = 0; i < num_envs; i++) {
+    env_storage.push_back(
+        std::make_unique<Env>(rom, score_addrs));
+    envs.push_back(env_storage.back().get());
+    if (preprocess_frames)
+      envs.back()->preprocess(obs_width, obs_height);
+  }
+
+  // The first environment works the start state out, and the rest share it.
+  if (use_start_state) {
+    uint64_t start_state_start = host_time_ns();
+    for (Env *env : envs) {
+      env->start_from(start_inputs, start_frames, cache_dir);
+      env->reset();
+    }
+    printf("Start state %ld frames in: %.3f ms\n", start_frames,
+           (host_time_ns() - start_state_start) / 1e6);
+  }
+
+  ThreadPool pool(num_threads);
+
+  std::vector<uint8_t> actions(num_envs);
+  std::vector<int64_t> rewards(num_envs);
+  std::vector<uint8_t> frames(
+      observe_frames ? num_envs * envs[0]->observation_size() : 0);
+  std::vector<uint8_t> rams(num_envs * Env::ram_size);
+
+  // Same actions every run, so runs can be compared.
+  uint32_t rng = 1;
+  int64_t total_reward = 0;
+  uint64_t start = host_time_ns();
+  for (int step = 0; step < steps; step++) {
+    for (uint8_t &action : actions) {
+      rng = rng * 1103515245 + 12345;
+      action = (rng >> 16) & 0x1F;
+    }
+
+    step_batch(pool, envs.data(), num_envs, actions.data(), frameskip,
+               rewards.data(), observe_frames ? frames.data() : nullptr,
+               rams.data());
+
+    for (int64_t reward : rewards)
+      total_reward += reward;
+
+    if (episode_steps && (step + 1) % episode_steps == 0)
+      pool.for_each(num_envs, [&](int i) { envs[i]->reset(); });
+  }
+  uint64_t elapsed_ns = host_time_ns() - start;
+
+  uint64_t total_steps = (uint64_t)steps * num_envs;
+  printf("%d environments on %d threads, %d frames per step\n", num_envs,
+         pool.num_threads(), frameskip);
+  printf("%lu steps in %.3f s, %.0f steps/s, %.0f frames/s\n", total_steps,
+         elapsed_ns / 1e9, total_steps * 1e9 / elapsed_ns,
+         total_steps * frameskip * 1e9 / elapsed_ns);
+  printf("Total reward: %ld\n", total_reward);
+
+  // FNV-1a of every environment's RAM, and last observation, which have to
+  // come out the same no matter how many threads there are.
+  printf("RAM hash: %016lx\n", hash_bytes(rams));
+  if (observe_frames)
+    printf("Frame hash: %016lx\n", hash_bytes(frames));
+
+  return 0;
+}
@@ -0,0 +1,78 @@
+// About the smallest Bus the 6502 core can run on: 64K of RAM and nothing
+// else. Loads a raw binary, runs it until it hits a BRK with no IRQ vector set,
+// and dumps the registers. Mostly here to show how to put the core in a system
+// other than the Atari, e.g. "cpu6502_example tests/fib.bin".
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cpu6502.h"
+
+class FlatBus {
+private:
+  uint8_t memory[0x10000] = {0};
+  bool dirty_pages[0x100] = {false};
+
+public:
+  uint8_t read_byte(uint16_t addr) { return memory[addr]; }
+
+  void write_byte(uint16_t addr, uint8_t val) {
+    memory[addr] = val;
+    dirty_pages[addr >> 8] = true;
+  }
+
+  bool has_side_effect(uint16_t addr) { return false; }
+
+  bool is_dirty_page(uint16_t addr) { return dirty_pages[addr >> 8]; }
+  void mark_page_clean(uint16_t addr) { dirty_pages[addr >> 8] = false; }
+
+  // Everything is RAM, so the CPU decodes it all itself.
+  const Cpu6502<FlatBus>::CachedInsn *shared_code(uint16_t addr) {
+    return nullptr;
+  }
+
+  void panic() { exit(-1); }
+};
+
+FlatBus bus;
+Cpu6502Registers regs;
+Cpu6502<FlatBus> cpu(bus, regs);
+
+void print_usage_and_exit() {
+  printf("Usage: cpu6502_example <program_file> [load_address]\n");
+  printf("The program is loaded at load_address (hex, 0xF000 by default),\n");
+  printf("and runs from the reset vector at 0xFFFC.\n");
+  exit(0);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 3)
+    print_usage_and_exit();
+
+  uint16_t load_addr = 0xF000;
+  if (argc == 3)
+    load_addr = strtoul(argv[2], nullptr, 16);
+
+  FILE *program_file = fopen(argv[1], "rb");
+  if (!program_file) {
+    printf("could not open %s\n", argv[1]);
+    exit(-1);
+  }
+  for (int addr = load_addr; addr < 0x10000; addr++) {
+    int c = fgetc(program_file);
+    if (c == EOF)
+      break;
+    bus.write_byte(addr, c);
+  }
+  fclose(program_file);
+
+  cpu.reset(cpu.read_word(0xFFFC));
+  cpu.should_execute = true;
+  while (cpu.should_execute)
+    cpu.execute_next_insn();
+
+  cpu.dump_regs();
+
+  return 0;
+}
@@ -0,0 +1,188 @@
+#include "farm.h"
+
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "bank_switchers.h"
+#include "console.h"
+#include "frame_stats.h"
+#include "input.h"
+#include "movie.h"
+#include "thread_pool.h"
+
+enum class JobResult {
+  // Ran for all of its frames, or to the end of its movie.
+  finished,
+  // The game stopped the CPU itself, with a BRK.
+  stopped,
+  crashed,
+  // Went too long without finishing a frame.
+  hung,
+};
+
+struct FarmJob {
+  std::string rom_filename;
+  std::shared_ptr<const RomImage> rom;
+  // The frame count or movie file, as written in the jobs file.
+  std::string budget;
+  uint64_t frame_limit = 0;
+  std::unique_ptr<Movie> movie;
+
+  JobResult result;
+  uint64_t frames;
+  uint64_t elapsed_ns;
+  uint64_t ram_hash;
+  uint16_t program_counter;
+};
+
+// Everything a job touches lives in its own console, so jobs never wait on
+// each other.
+static void run_job(FarmJob &job) {
+  Controls controls;
+  Console console(job.rom, controls);
+  console.tia =
+      std::make_unique<TIA>(console.state.tia, console.state.cpu.cycle_num,
+                            controls, std::unique_ptr<Display>());
+  console.tia->set_drawing(false);
+  console.bus.exit_on_panic = false;
+  console.power_on();
+
+  uint64_t start = host_time_ns();
+  job.result = JobResult::finished;
+  while (true) {
+    if (!console.cpu.should_execute) {
+      job.result =
+          console.state.bus.crashed ? JobResult::crashed : JobResult::stopped;
+      break;
+    }
+    if (job.frame_limit && console.tia->ntsc->frames >= job.frame_limit)
+      break;
+    if (job.movie && !job.movie->next_frame(controls))
+      break;
+    if (!console.run_frame()) {
+      job.result = JobResult::hung;
+      break;
+    }
+  }
+  job.elapsed_ns = host_time_ns() - start;
+
+  job.frames = console.tia->ntsc->frames;
+  job.ram_hash = console.bus.hash_memory();
+  job.program_counter = console.state.bus.crashed
+                            ? console.state.bus.crash_program_counter
+                            : console.state.cpu.program_counter;
+}
+
+static std::vector<FarmJob> read_jobs(const char *jobs_filename) {
+  FILE *file = fopen(jobs_filename, "r");
+  if (!file) {
+    printf("could not open %s\n", jobs_filename);
+    exit(-1);
+  }
+
+  std::vector<FarmJob> jobs;
+  // Jobs running the same ROM share one copy of it.
+  std::map<std::string, std::shared_ptr<const RomImage>> roms;
+  char line[1024];
+  int line_num = 0;
+  while (fgets(line, sizeof(line), file)) {
+    line_num++;
+    char rom_filename[1024], bank_switcher[1024], budget[1024];
+    int fields = sscanf(line, "%1023s %1023s %1023s", rom_filename,
+                        bank_switcher, budget);
+    if (fields <= 0 || rom_filename[0] == '#')
+      continue;
+    if (fields != 3) {
+      printf("Error! %s:%d should be <program_file> <bankswitch> "
+             "<frames|movie>\n",
+             jobs_filename, line_num);
+      exit(-1);
+    }
+
+    jobs.emplace_back();
+    FarmJob &job = jobs.back();
+    job.rom_filename = rom_filename;
+    BankSwitcherType bank_switcher_type;
+    if (!parse_bank_switcher_type(bank_switcher, bank_switcher_type)) {
+      printf("Error! Invalid bankswitch type %s at %s:%d\n", bank_switcher,
+             jobs_filename, line_num);
+      exit(-1);
+    }
+    std::shared_ptr<const RomImage> &rom =
+        roms[job.rom_filename + " " + bank_switcher];
+    if (!rom)
+      rom = read_rom(rom_filename, bank_switcher_type);
+    job.rom = rom;
+
+    // Anything that isn't a number is a movie.
+    job.budget = budget;
+    char *end_ptr;
+    job.frame_limit = strtoull(budget, &end_ptr, 10);
+    if (*end_ptr || !job.frame_limit) {
+      job.frame_limit = 0;
+      job.movie = std::make_unique<Movie>(budget, false);
+    }
+  }
+  fclose(file);
+
+  return jobs;
+}
+
+static const char *describe_result(const FarmJob &job) {
+  static thread_local char description[64];
+  switch (job.result) {
+  case JobResult::finished:
+    return "ok";
+  case JobResult::stopped:
+    snprintf(description, sizeof(description), "stopped at PC %04x",
+             job.program_counter);
+    return description;
+  case JobResult::crashed:
+    snprintf(description, sizeof(description), "CRASHED at PC %04x",
+             job.program_counter);
+    return description;
+  case JobResult::hung:
+    snprintf(description, sizeof(description), "HUNG at PC %04x",
+             job.program_counter);
+    return description;
+  }
+  return "";
+}
+
+int run_farm(const char *jobs_filename) {
+  std::vector<FarmJob> jobs = read_jobs(jobs_filename);
+
+  ThreadPool pool;
+  uint64_t start = host_time_ns();
+  pool.for_each(jobs.size(), [&](int i) { run_job(jobs[i]); });
+  uint64_t elapsed_ns = host_time_ns() - start;
+
+  printf("%-4s %-32s %-24s %8s %10s %-16s  %s\n", "Job", "ROM", "Budget",
+         "Ran", "FPS", "RAM hash", "Result");
+  uint64_t total_frames = 0;
+  int failures = 0;
+  for (size_t i = 0; i < jobs.size(); i++) {
+    const FarmJob &job = jobs[i];
+    printf("%-4lu %-32s %-24s %8lu %10.0f %016lx  %s\n", i + 1,
+           job.rom_filename.c_str(), job.budget.c_str(), job.frames,
+           job.frames * 1e9 / job.elapsed_ns, job.ram_hash,
+           describe_result(job));
+
+    total_frames += job.frames;
+    if (job.result == JobResult::crashed || job.result == JobResult::hung)
+      failures++;
+  }
+
+  printf("%lu jobs on %d threads in %.2f s, %.0f frames/s overall, %d "
+         "crashed or hung\n",
+         jobs.size(), pool.num_threads(), elapsed_ns / 1e9,
+         total_frames * 1e9 / elapsed_ns, failures);
+
+  return failures;
+}
@@ -0,0 +1,19 @@
+#ifndef FARM_H
+#define FARM_H
+
+// Runs a list of jobs on headless consoles spread across every physical core,
+// and prints how each one went: how fast it ran, the hash of RAM it finished
+// with, and whether it crashed. Consoles that crash don't take the rest down
+// with them. Handy for checking a change against a whole library of games.
+//
+// The jobs file has one job per line, a ROM, its bankswitch type, and either
+// a number of frames to run for or a movie to play back:
+//
+//   games/pitfall.bin none 3600
+//   games/centipede.bin atari8k movies/centipede.c26m
+//
+// Blank lines and lines starting with # are skipped. Returns the number of
+// jobs that crashed or hung.
+int run_farm(const char *jobs_filename);
+
+#endif
@@ -0,0 +1,128 @@
+#include "frame_export.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ntsc.h"
+
+static_assert(shm_frame_width == NTSC::visible_columns &&
+                  shm_frame_height == NTSC::visible_scanlines,
+              "Shared frames must be the size of the screen");
+
+// How long to wait on the consumer before checking it's still there.
+const static int answer_timeout_ms = 100;
+
+FrameExport::FrameExport(const char *name, bool lockstep,
+                         std::unique_ptr<Display> display,
+                         const uint64_t &frames, const uint8_t *ram,
+                         Controls &controls)
+    : name(name), display(std::move(display)), frames(frames), ram(ram),
+      controls(controls), lockstep(lockstep), stopping(false) {
+  // Start over with a fresh segment, so nobody still attached to an old one
+  // gets confused by us.
+  shm_unlink(name);
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0 || ftruncate(fd, sizeof(SharedFrames))) {
+    printf("Error! Could not create shared memory %s: %s\n", name,
+           strerror(errno));
+    exit(-1);
+  }
+  void *mapping = mmap(nullptr, sizeof(SharedFrames), PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    printf("Error! Could not map shared memory %s: %s\n", name,
+           strerror(errno));
+    exit(-1);
+  }
+
+  // New segments are zeroed, so only the header needs filling in.
+  shared = (SharedFrames *)mapping;
+  shared->version = shm_frames_version;
+  shared->slot_count = shm_slot_count;
+  shared->frame_width = shm_frame_width;
+  shared->frame_height = shm_frame_height;
+  shared->lockstep = lockstep;
+  shared->magic = shm_frames_magic;
+
+  open_slot();
+}
+
+FrameExport::~FrameExport() {
+  shared->closed = 1;
+  futex_wake(shared->published);
+  munmap(shared, sizeof(SharedFrames));
+  shm_unlink(name.c_str());
+}
+
+// Marks the slot as being written, and draws the next frame straight into it.
+void FrameExport::open_slot() {
+  SharedFrame &frame = shared->slots[slot];
+  frame.sequence.store(frame.sequence.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  framebuf = frame.pixels;
+}
+
+void FrameExport::wait_for_answer(uint32_t published) {
+  bool announced = false;
+  while (!stopping) {
+    uint32_t answered = shared->answered;
+    if (answered == published)
+      return;
+
+    int32_t pid = shared->consumer_pid;
+    if (!pid && !announced) {
+      printf("Waiting for a consumer on %s\n", name.c_str());
+      fflush(stdout);
+      announced = true;
+    } else if (pid && kill(pid, 0) && errno == ESRCH) {
+      printf("Consumer %d went away, waiting for another on %s\n", pid,
+             name.c_str());
+      fflush(stdout);
+      shared->consumer_pid.compare_exchange_strong(pid, 0);
+      announced = true;
+    }
+
+    futex_wait(shared->answered, answered, answer_timeout_ms);
+  }
+}
+
+void FrameExport::swap_buf() {
+  SharedFrame &frame = shared->slots[slot];
+  frame.frame_num = frames;
+  memcpy(frame.ram, ram, shm_ram_size);
+  frame.sequence.store(frame.sequence.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_release);
+
+  uint32_t published = shared->published + 1;
+  shared->published = published;
+  if (shared->waiting)
+    futex_wake(shared->published);
+
+  if (display) {
+    memcpy(display->framebuf, framebuf, shm_frame_width * shm_frame_height);
+    display->swap_buf();
+  }
+
+  if (lockstep)
+    wait_for_answer(published);
+
+  // The consumer stores the joysticks before it bumps the count.
+  uint32_t input_count = shared->input_count;
+  if (input_count != last_input_count) {
+    last_input_count = input_count;
+    uint32_t joysticks = shared->joysticks;
+    controls.set_joystick(0, joysticks & 0xFF);
+    controls.set_joystick(1, joysticks >> 8 & 0xFF);
+  }
+
+  slot = (slot + 1) % shm_slot_count;
+  open_slot();
+}
@@ -0,0 +1,55 @@
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+#include "display.h"
+#include "input.h"
+#include "shm_frames.h"
+
+#ifndef FRAME_EXPORT_H
+#define FRAME_EXPORT_H
+
+// Publishes every frame drawn, along with RAM, to a POSIX shared memory
+// segment for other processes, and feeds the joystick input they send back
+// into the console. See shm_frames.h for the layout.
+//
+// This sits in front of the console's real display, which may be null. Frames
+// are drawn straight into the shared slots, and copied on to the real display
+// if there is one.
+class FrameExport : public Display {
+  std::string name;
+  SharedFrames *shared;
+  std::unique_ptr<Display> display;
+
+  // The console's frame counter, RAM, and joysticks.
+  const uint64_t &frames;
+  const uint8_t *ram;
+  Controls &controls;
+
+  bool lockstep;
+  std::atomic<bool> stopping;
+  // The slot being drawn into.
+  int slot = 0;
+  uint32_t last_input_count = 0;
+
+  void open_slot();
+  void wait_for_answer(uint32_t published);
+
+public:
+  // Creates the segment |name|, e.g. "/check2600", replacing any left over
+  // from before. If |lockstep| is set, every frame waits for a consumer to
+  // answer it.
+  FrameExport(const char *name, bool lockstep,
+              std::unique_ptr<Display> display, const uint64_t &frames,
+              const uint8_t *ram, Controls &controls);
+  ~FrameExport();
+
+  void swap_buf() override;
+
+  // Stops waiting on the consumer, e.g. because the window was closed. Safe to
+  // call from any thread.
+  void stop() { stopping = true; }
+};
+
+#endif
@@ -0,0 +1,195 @@
+#include "frame_stats.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+#include <string>
+
+FrameStats frame_stats;
+
+uint64_t host_time_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+Histogram::Histogram() {
+  for (int i = 0; i < num_buckets; i++)
+    counts[i] = 0;
+  total_count = 0;
+  total_sum = 0;
+  max_value = 0;
+}
+
+int Histogram::bucket_for_value(uint64_t value) {
+  if (value < sub_buckets)
+    return value;
+
+  int msb = 63 - __builtin_clzll(value);
+  int magnitude = msb - sub_bucket_bits + 1;
+  if (magnitude > magnitudes)
+    return num_buckets - 1;
+
+  int sub_bucket = (value >> (magnitude - 1)) - sub_buckets;
+  return magnitude * sub_buckets + sub_bucket;
+}
+
+uint64_t Histogram::value_for_bucket(int bucket) {
+  int magnitude = bucket / sub_buckets;
+  uint64_t sub_bucket = bucket % sub_buckets;
+  if (!magnitude)
+    return sub_bucket;
+
+  uint64_t lowest = (sub_buckets + sub_bucket) << (magnitude - 1);
+  return lowest + (1ull << (magnitude - 1)) - 1;
+}
+
+void Histogram::record(uint64_t value) {
+  counts[bucket_for_value(value)].fetch_add(1, std::memory_order_relaxed);
+  total_count.fetch_add(1, std::memory_order_relaxed);
+  total_sum.fetch_add(value, std::memory_order_relaxed);
+
+  uint64_t prev_max = max_value.load(std::memory_order_relaxed);
+  while (value > prev_max &&
+         !max_value.compare_exchange_weak(prev_max, value,
+                                          std::memory_order_relaxed))
+    ;
+}
+
+uint64_t Histogram::get_percentile(double percentile) const {
+  uint64_t count = get_count();
+  if (!count)
+    return 0;
+
+  uint64_t target = (uint64_t)ceil(percentile / 100.0 * count);
+  if (!target)
+    target = 1;
+
+  uint64_t seen = 0;
+  for (int i = 0; i < num_buckets; i++) {
+    seen += counts[i].load(std::memory_order_relaxed);
+    if (seen >= target) {
+      uint64_t ret = value_for_bucket(i);
+      return ret < get_max() ? ret : get_max();
+    }
+  }
+
+  return get_max();
+}
+
+double Histogram::get_mean() const {
+  uint64_t count = get_count();
+  if (!count)
+    return 0;
+  return (double)total_sum.load(std::memory_order_relaxed) / count;
+}
+
+FrameStats::FrameStats() {
+  late_frames = 0;
+  max_lag_us = 0;
+  dropped_frames = 0;
+}
+
+void FrameStats::add_tia(uint64_t ns) {
+  tia_ns += ns > nested_ns ? ns - nested_ns : 0;
+  nested_ns = 0;
+}
+
+void FrameStats::add_wait(uint64_t ns) {
+  wait_ns += ns;
+  nested_ns += ns;
+}
+
+void FrameStats::add_late_frame(int64_t lag_us) {
+  late_frames.fetch_add(1, std::memory_order_relaxed);
+  if (lag_us > max_lag_us.load(std::memory_order_relaxed))
+    max_lag_us.store(lag_us, std::memory_order_relaxed);
+}
+
+void FrameStats::end_frame() {
+  uint64_t now = host_time_ns();
+
+  // The first frame has nothing to measure against.
+  if (last_frame_end_ns) {
+    frame.record(now - last_frame_end_ns);
+    if (per_subsystem) {
+      cpu.record(cpu_ns);
+      tia.record(tia_ns);
+      pia.record(pia_ns);
+    }
+    wait.record(wait_ns);
+  }
+
+  cpu_ns = 0;
+  tia_ns = 0;
+  pia_ns = 0;
+  wait_ns = 0;
+  last_frame_end_ns = now;
+}
+
+// The order here matches the order of the columns in dump() and write_json().
+struct NamedHistogram {
+  const char *name;
+  Histogram *histogram;
+};
+
+void FrameStats::dump() {
+  NamedHistogram histograms[] = {
+      {"frame", &frame}, {"cpu", &cpu},         {"tia", &tia},
+      {"pia", &pia},     {"convert", &convert}, {"wait", &wait},
+      {"present", &present},
+  };
+
+  printf("%-10s %10s %10s %10s %10s %10s\n", "(us)", "p50", "p95", "p99",
+         "max", "frames");
+  for (auto &h : histograms) {
+    printf("%-10s %10.1f %10.1f %10.1f %10.1f %10lu\n", h.name,
+           h.histogram->get_percentile(50) / 1000.0,
+           h.histogram->get_percentile(95) / 1000.0,
+           h.histogram->get_percentile(99) / 1000.0,
+           h.histogram->get_max() / 1000.0, h.histogram->get_count());
+  }
+  printf("Late frames: %lu  Max lag: %ld us  Dropped frames: %lu\n",
+         late_frames.load(), max_lag_us.load(), dropped_frames.load());
+}
+
+void FrameStats::write_json(FILE *file) {
+  NamedHistogram histograms[] = {
+      {"frame", &frame}, {"cpu", &cpu},         {"tia", &tia},
+      {"pia", &pia},     {"convert", &convert}, {"wait", &wait},
+      {"present", &present},
+  };
+
+  fprintf(file, "{\n");
+  for (auto &h : histograms) {
+    fprintf(file,
+            "  \"%s\": {\"count\": %lu, \"mean_us\": %.3f, \"p50_us\": %.3f, "
+            "\"p95_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f},\n",
+            h.name, h.histogram->get_count(), h.histogram->get_mean() / 1000.0,
+            h.histogram->get_percentile(50) / 1000.0,
+            h.histogram->get_percentile(95) / 1000.0,
+            h.histogram->get_percentile(99) / 1000.0,
+            h.histogram->get_max() / 1000.0);
+  }
+  fprintf(file, "  \"late_frames\": %lu,\n", late_frames.load());
+  fprintf(file, "  \"max_lag_us\": %ld,\n", max_lag_us.load());
+  fprintf(file, "  \"dropped_frames\": %lu\n", dropped_frames.load());
+  fprintf(file, "}\n");
+}
+
+std::string stats_filename;
+
+void write_stats_at_exit() {
+  FILE *file = fopen(stats_filename.c_str(), "w");
+  if (!file) {
+    printf("Error! Could not open %s\n", stats_filename.c_str());
+    return;
+  }
+  frame_stats.write_json(file);
+  fclose(file);
+}
+
+void dump_frame_stats_on_exit(const char *filename) {
+  stats_filename = filename;
+  atexit(write_stats_at_exit);
+}
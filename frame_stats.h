@@ -0,0 +1,110 @@
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+// Log-linear histogram in the spirit of HdrHistogram. Every power of two is
+// split into a fixed number of sub-buckets, so the relative error of any
+// reported value is bounded by 1 / sub_buckets no matter the magnitude.
+// Recording is lock-free, so the emulation thread can record while another
+// thread reads percentiles.
+class Histogram {
+  const static int sub_bucket_bits = 5;
+  const static int sub_buckets = 1 << sub_bucket_bits;
+  // Enough magnitudes for about 35 minutes worth of nanoseconds.
+  const static int magnitudes = 36;
+  const static int num_buckets = (magnitudes + 1) * sub_buckets;
+
+  std::atomic<uint64_t> counts[num_buckets];
+  std::atomic<uint64_t> total_count;
+  std::atomic<uint64_t> total_sum;
+  std::atomic<uint64_t> max_value;
+
+  static int bucket_for_value(uint64_t value);
+  // Returns the highest value that maps to the given bucket.
+  static uint64_t value_for_bucket(int bucket);
+
+public:
+  Histogram();
+
+  void record(uint64_t value);
+
+  // |percentile| is in the range [0, 100].
+  uint64_t get_percentile(double percentile) const;
+  uint64_t get_max() const { return max_value.load(std::memory_order_relaxed); }
+  uint64_t get_count() const {
+    return total_count.load(std::memory_order_relaxed);
+  }
+  double get_mean() const;
+};
+
+// Host time spent per emulated frame, split up by subsystem. All durations are
+// in nanoseconds.
+class FrameStats {
+  // Accumulators for the frame in progress. These are only ever touched by the
+  // emulation thread.
+  uint64_t cpu_ns = 0;
+  uint64_t tia_ns = 0;
+  uint64_t pia_ns = 0;
+  uint64_t wait_ns = 0;
+  uint64_t last_frame_end_ns = 0;
+
+  // Waiting happens inside the TIA's VSYNC handler, so we track it here to
+  // keep it from being counted twice.
+  uint64_t nested_ns = 0;
+
+public:
+  // Whether the main loop should time the CPU, TIA and PIA individually. This
+  // costs a few clock reads per instruction, so it's off unless asked for.
+  bool per_subsystem = false;
+
+  Histogram frame;
+  Histogram cpu;
+  Histogram tia;
+  Histogram pia;
+  Histogram convert;
+  Histogram wait;
+  // Time from a frame being finished to it being drawn to the window.
+  Histogram present;
+
+  std::atomic<uint64_t> late_frames;
+  std::atomic<int64_t> max_lag_us;
+  // Frames the render thread was too far behind to take, in pipelined mode.
+  std::atomic<uint64_t> dropped_frames;
+
+  FrameStats();
+
+  void add_cpu(uint64_t ns) { cpu_ns += ns; }
+  void add_tia(uint64_t ns);
+  void add_pia(uint64_t ns) { pia_ns += ns; }
+  // Conversion happens on the UI thread, so it goes straight into the
+  // histogram instead of the per-frame accumulators.
+  void add_convert(uint64_t ns) { convert.record(ns); }
+  void add_present(uint64_t ns) { present.record(ns); }
+  void add_wait(uint64_t ns);
+  void add_late_frame(int64_t lag_us);
+  void add_dropped_frame() {
+    dropped_frames.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Records the frame in progress into the histograms.
+  void end_frame();
+
+  // Print a summary table to STDOUT.
+  void dump();
+
+  // Write all statistics as a JSON object.
+  void write_json(FILE *file);
+};
+
+extern FrameStats frame_stats;
+
+// Host monotonic clock in nanoseconds.
+uint64_t host_time_ns();
+
+// Write the statistics as JSON to |filename| when the program exits.
+void dump_frame_stats_on_exit(const char *filename);
+
+#endif
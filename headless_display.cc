@@ -0,0 +1,13 @@
+// For builds without a window, like the RL environment library. Nothing in
+// them ever asks for a window, but the NTSC still needs something to link
+// against.
+
+#include "display.h"
+
+std::unique_ptr<Display> create_display(int width, int height, int scale) {
+  return nullptr;
+}
+
+void request_quit() {}
+
+double host_refresh_hz() { return 0; }
@@ -1,11 +1,42 @@
-bool player0_up = false;
-bool player0_down = false;
-bool player0_left = false;
-bool player0_right = false;
-bool player0_fire = false;
-
-bool player1_up = false;
-bool player1_down = false;
-bool player1_left = false;
-bool player1_right = false;
-bool player1_fire = false;
+#include "input.h"
+
+Controls controls;
+
+std::atomic<int> frameskip(1);
+std::atomic<bool> drawing_required(false);
+
+static uint8_t pack_joystick(bool up, bool down, bool left, bool right,
+                             bool fire) {
+  return (up ? Controls::joystick_up : 0) |
+         (down ? Controls::joystick_down : 0) |
+         (left ? Controls::joystick_left : 0) |
+         (right ? Controls::joystick_right : 0) |
+         (fire ? Controls::joystick_fire : 0);
+}
+
+static void unpack_joystick(uint8_t joystick, bool &up, bool &down,
+                            bool &left, bool &right, bool &fire) {
+  up = joystick & Controls::joystick_up;
+  down = joystick & Controls::joystick_down;
+  left = joystick & Controls::joystick_left;
+  right = joystick & Controls::joystick_right;
+  fire = joystick & Controls::joystick_fire;
+}
+
+uint8_t Controls::get_joystick(int player) const {
+  if (player)
+    return pack_joystick(player1_up, player1_down, player1_left, player1_right,
+                         player1_fire);
+  return pack_joystick(player0_up, player0_down, player0_left, player0_right,
+                       player0_fire);
+}
+
+void Controls::set_joystick(int player, uint8_t joystick) {
+  if (player) {
+    unpack_joystick(joystick, player1_up, player1_down, player1_left,
+                    player1_right, player1_fire);
+  } else {
+    unpack_joystick(joystick, player0_up, player0_down, player0_left,
+                    player0_right, player0_fire);
+  }
+}
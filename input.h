@@ -1,19 +1,47 @@
+#include <atomic>
+#include <stdint.h>
+
 #ifndef INPUT_H
 #define INPUT_H
 
-// Paddle control values from event thread to be read by the TIA.
+// Paddle control values, to be read by a console's TIA and PIA. Each console
+// reads its own, so they're passed in rather than read from here.
 // TODO: Support other types of controls.
+struct Controls {
+  bool player0_up = false;
+  bool player0_down = false;
+  bool player0_left = false;
+  bool player0_right = false;
+  bool player0_fire = false;
+
+  bool player1_up = false;
+  bool player1_down = false;
+  bool player1_left = false;
+  bool player1_right = false;
+  bool player1_fire = false;
+
+  // One player's joystick packed into a byte, the way movies store it and the
+  // RL environment takes actions.
+  const static uint8_t joystick_up = 0x01;
+  const static uint8_t joystick_down = 0x02;
+  const static uint8_t joystick_left = 0x04;
+  const static uint8_t joystick_right = 0x08;
+  const static uint8_t joystick_fire = 0x10;
+
+  uint8_t get_joystick(int player) const;
+  void set_joystick(int player, uint8_t joystick);
+};
+
+// The controls of the emulator's own console, from the event thread.
+extern Controls controls;
+
+// Draw one frame in every |frameskip|, or none at all if it's 0. Skipped
+// frames run the game exactly the same, they just aren't drawn. Set from the
+// command line and cycled with a hotkey.
+extern std::atomic<int> frameskip;
 
-extern bool player0_up;
-extern bool player0_down;
-extern bool player0_left;
-extern bool player0_right;
-extern bool player0_fire;
-
-extern bool player1_up;
-extern bool player1_down;
-extern bool player1_left;
-extern bool player1_right;
-extern bool player1_fire;
+// Set while something other than the window relies on frames being drawn, like
+// --shm's consumer, in which case the hotkey skips turning drawing off.
+extern std::atomic<bool> drawing_required;
 
 #endif
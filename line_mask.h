@@ -0,0 +1,54 @@
+#include <stdint.h>
+
+#ifndef LINE_MASK_H
+#define LINE_MASK_H
+
+// One bit per visible pixel of a scanline, for tracking which pixels an object
+// covers. Sprites wrap around from the right edge of the screen to the left,
+// so writes past the end wrap around too.
+class LineMask {
+public:
+  const static int width = 160;
+
+  uint64_t bits[3];
+
+  LineMask() { clear(); }
+
+  void clear() { bits[0] = bits[1] = bits[2] = 0; }
+
+  bool empty() const { return !(bits[0] | bits[1] | bits[2]); }
+
+  // OR the low |count| bits of |val| in starting at |pos|, wrapping around the
+  // end of the line. |count| must be at most 64.
+  void insert(int pos, uint64_t val, int count) {
+    if (pos + count > width) {
+      int first = width - pos;
+      insert_unwrapped(pos, val & ((1ull << first) - 1));
+      insert_unwrapped(0, val >> first);
+    } else {
+      insert_unwrapped(pos, val);
+    }
+  }
+
+  // Returns |count| bits starting at |pos|. The range must not run past the end
+  // of the line, and |count| must be at most 64.
+  uint64_t extract(int pos, int count) const {
+    int word = pos / 64;
+    int shift = pos % 64;
+    uint64_t ret = bits[word] >> shift;
+    if (shift && word < 2)
+      ret |= bits[word + 1] << (64 - shift);
+    return count < 64 ? ret & ((1ull << count) - 1) : ret;
+  }
+
+private:
+  void insert_unwrapped(int pos, uint64_t val) {
+    int word = pos / 64;
+    int shift = pos % 64;
+    bits[word] |= val << shift;
+    if (shift && word < 2)
+      bits[word + 1] |= val >> (64 - shift);
+  }
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include <QApplication>
+#include <getopt.h>
 #include <memory>
 #include <stdint.h>
 #include <stdio.h>
@@ -7,27 +8,75 @@
 
 #include "atari.h"
 #include "bank_switchers.h"
+#include "farm.h"
+#include "frame_stats.h"
+#include "input.h"
+#include "ntsc.h"
 
 void print_usage_and_exit() {
-  printf("Usage: atari2600 [-d] [-s scale]  -f <program_file>\n");
+  printf("Usage: atari2600 [-d] [-p] [-s scale] [-r speed] [-k frameskip] "
+         "[-t stats.json] [-x frames] [-c trace] [-m movie] [-M movie] "
+         "[-w audio.wav] [--shm name [--lockstep]] -f <program_file>\n");
+  printf("       atari2600 --farm <jobs_file>\n");
   printf("-d: Enter debug mode.\n");
+  printf("-p: Draw frames on a separate render thread. Frames are dropped if\n");
+  printf("    it falls behind.\n");
   printf("-s: Set UI scale. Default is 4.\n");
   printf("-h: Show this help menu and exit.\n");
+  printf("-r: Set emulation speed as a multiple of real time, or \"unlimited\".\n");
+  printf("    \"audio\" follows the sound card instead of the host clock.\n");
+  printf("    Default is 1.\n");
+  printf("-k: Draw one frame in every N, or \"off\" to not draw at all.\n");
+  printf("    Default is 1. Press F to cycle through frameskip settings.\n");
+  printf("-c: Capture a trace of every TIA register write to the given file,\n");
+  printf("    for replaying with tia_bench.\n");
+  printf("-x: Exit after the given number of frames and print a hash of RAM.\n");
+  printf("-m: Play back the controls from the given movie, and exit when it\n");
+  printf("    runs out.\n");
+  printf("-M: Record the controls to the given movie.\n");
+  printf("-w: Run without a window as fast as possible, writing the audio to\n");
+  printf("    the given WAV file. Needs -x or -m to know when to stop.\n");
+  printf("-t: Time each frame and write the statistics as JSON to the given\n");
+  printf("    file on exit.\n");
   printf("-b: Select bankswitch mode.\n");
   printf("    Currently supports Atari8K, Atari16K, and Atari32K.\n");
+  printf("--shm: Publish every frame drawn, and RAM, to the given POSIX\n");
+  printf("    shared memory segment, and take joystick input back from it.\n");
+  printf("    See shm_frames.h.\n");
+  printf("--lockstep: With --shm, wait for the consumer to answer every\n");
+  printf("    frame before starting the next.\n");
+  printf("--farm: Run every job in the given file on headless consoles, one\n");
+  printf("    thread per core, and print a report. Each line of the file is\n");
+  printf("    \"<program_file> <bankswitch> <frames|movie_file>\".\n");
   exit(0);
 }
 
 int main(int argc, char **argv) {
-  QApplication app(argc, argv);
-
   char *filename = nullptr;
+  char *trace_filename = nullptr;
+  char *movie_filename = nullptr;
+  char *wav_filename = nullptr;
+  bool recording_movie = false;
   bool debug = false;
+  bool pipelined = false;
+  uint64_t frame_limit = 0;
   int scale = 4;
+  double speed = 1.0;
   BankSwitcherType bank_switcher_type = BankSwitcherType::none;
+  char *jobs_filename = nullptr;
+  char *shm_name = nullptr;
+  bool lockstep = false;
+
+  const struct option long_options[] = {
+      {"farm", required_argument, nullptr, 'F'},
+      {"shm", required_argument, nullptr, 'S'},
+      {"lockstep", no_argument, nullptr, 'L'},
+      {nullptr, 0, nullptr, 0},
+  };
 
   int c;
-  while ((c = getopt(argc, argv, "hds:f:b:")) != -1) {
+  while ((c = getopt_long(argc, argv, "hdps:r:k:x:c:t:m:M:w:f:b:",
+                          long_options, nullptr)) != -1) {
     switch (c) {
     case 'h':
       print_usage_and_exit();
@@ -35,6 +84,9 @@ int main(int argc, char **argv) {
     case 'd':
       debug = true;
       break;
+    case 'p':
+      pipelined = true;
+      break;
     case 's':
       scale = atoi(optarg);
       if (scale <= 0) {
@@ -42,38 +94,156 @@ int main(int argc, char **argv) {
         exit(-1);
       }
       break;
+    case 'r':
+      if (!strcmp(optarg, "unlimited")) {
+        speed = 0;
+      } else if (!strcmp(optarg, "audio")) {
+        speed = NTSC::audio_speed;
+      } else {
+        speed = atof(optarg);
+        if (speed <= 0) {
+          printf("Error! Invalid speed %s\n", optarg);
+          exit(-1);
+        }
+      }
+      break;
+    case 'k':
+      if (!strcmp(optarg, "off")) {
+        frameskip = 0;
+      } else {
+        frameskip = atoi(optarg);
+        if (frameskip <= 0) {
+          printf("Error! Invalid frameskip %s\n", optarg);
+          exit(-1);
+        }
+      }
+      break;
+    case 'x':
+      frame_limit = strtoull(optarg, nullptr, 10);
+      if (!frame_limit) {
+        printf("Error! Invalid frame count %s\n", optarg);
+        exit(-1);
+      }
+      break;
+    case 'c':
+      trace_filename = optarg;
+      break;
+    case 'm':
+    case 'M':
+      movie_filename = optarg;
+      recording_movie = c == 'M';
+      break;
+    case 'w':
+      wav_filename = optarg;
+      break;
+    case 't':
+      frame_stats.per_subsystem = true;
+      dump_frame_stats_on_exit(optarg);
+      break;
     case 'f':
       filename = (char *)malloc(strlen(optarg) + 1);
       strcpy(filename, optarg);
       break;
     case 'b':
-      if (!strncmp(optarg, "none", strlen("none"))) {
-        bank_switcher_type = BankSwitcherType::none;
-      } else if (!strncmp(optarg, "atari8k", strlen("atari8k"))) {
-        bank_switcher_type = BankSwitcherType::atari8k;
-      } else if (!strncmp(optarg, "atari16k", strlen("atari16k"))) {
-        bank_switcher_type = BankSwitcherType::atari16k;
-      } else if (!strncmp(optarg, "atari32k", strlen("atari32k"))) {
-        bank_switcher_type = BankSwitcherType::atari32k;
-      } else {
+      if (!parse_bank_switcher_type(optarg, bank_switcher_type)) {
         printf("Error! Invalid bankswitch type %s\n", optarg);
         exit(-1);
       }
       break;
+    case 'F':
+      jobs_filename = optarg;
+      break;
+    case 'S':
+      shm_name = optarg;
+      break;
+    case 'L':
+      lockstep = true;
+      break;
     default:
       printf("Invalid argument %c\n", c);
       print_usage_and_exit();
     }
   }
 
+  // The farm brings its own consoles and never opens a window.
+  if (jobs_filename)
+    return run_farm(jobs_filename) ? -1 : 0;
+
   if (!filename)
     print_usage_and_exit();
 
-  load_program_file(filename, scale, bank_switcher_type);
+  // The debugger shows frames as they're being drawn, which the render thread
+  // can't do.
+  if (debug && pipelined) {
+    printf("Warning! -p is not supported in debug mode, ignoring it.\n");
+    pipelined = false;
+  }
+
+  if (debug && movie_filename) {
+    printf("Warning! -m and -M are not supported in debug mode, ignoring "
+           "them.\n");
+    movie_filename = nullptr;
+  }
+
+  // Frames are published as they're drawn, on the emulation thread, along
+  // with RAM as it is right then. The render thread draws them later.
+  if (shm_name && (debug || pipelined)) {
+    printf("Error! --shm is not supported with -d or -p\n");
+    exit(-1);
+  }
+  if (shm_name && !frameskip) {
+    printf("Error! --shm needs frames to be drawn, it can't be used with "
+           "-k off\n");
+    exit(-1);
+  }
+  if (lockstep && !shm_name) {
+    printf("Error! --lockstep needs --shm\n");
+    exit(-1);
+  }
+
+  // Rendering audio to a file doesn't need QT5 at all, so we run it right here
+  // and skip the window and the sound card.
+  if (wav_filename) {
+    if (debug) {
+      printf("Error! -w is not supported in debug mode\n");
+      exit(-1);
+    }
+    if (!frame_limit && (!movie_filename || recording_movie)) {
+      printf("Error! -w needs -x or a movie to play back\n");
+      exit(-1);
+    }
+
+    load_program_file(filename, scale, bank_switcher_type, 0, false, true);
+    if (shm_name)
+      export_frames(shm_name, lockstep);
+    if (trace_filename)
+      capture_tia_trace(trace_filename);
+    if (movie_filename)
+      load_movie(movie_filename, recording_movie);
+
+    render_audio(wav_filename, frame_limit);
+
+    free(filename);
+    return 0;
+  }
+
+  QApplication app(argc, argv);
+
+  load_program_file(filename, scale, bank_switcher_type, speed, pipelined);
+  if (shm_name)
+    export_frames(shm_name, lockstep);
+  if (trace_filename)
+    capture_tia_trace(trace_filename);
+  if (movie_filename)
+    load_movie(movie_filename, recording_movie);
 
-  start_emulation_thread(debug);
+  start_emulation_thread(debug, frame_limit);
 
   free(filename);
 
-  return app.exec();
+  int ret = app.exec();
+
+  stop_emulation_thread();
+
+  return ret;
 }
@@ -0,0 +1,48 @@
+#include "movie.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char movie_magic[4] = {'C', '2', '6', 'M'};
+static const uint8_t movie_version = 1;
+
+Movie::Movie(const char *filename, bool recording) {
+  this->recording = recording;
+
+  file = fopen(filename, recording ? "wb" : "rb");
+  if (!file) {
+    printf("could not open %s\n", filename);
+    exit(-1);
+  }
+
+  uint8_t header[5];
+  if (recording) {
+    memcpy(header, movie_magic, sizeof(movie_magic));
+    header[4] = movie_version;
+    fwrite(header, sizeof(header), 1, file);
+  } else if (fread(header, sizeof(header), 1, file) != 1 ||
+             memcmp(header, movie_magic, sizeof(movie_magic)) ||
+             header[4] != movie_version) {
+    printf("Error! %s is not a movie\n", filename);
+    exit(-1);
+  }
+}
+
+Movie::~Movie() { fclose(file); }
+
+bool Movie::next_frame(Controls &controls) {
+  uint8_t inputs[2];
+
+  if (recording) {
+    inputs[0] = controls.get_joystick(0);
+    inputs[1] = controls.get_joystick(1);
+    fwrite(inputs, sizeof(inputs), 1, file);
+    return true;
+  }
+
+  if (fread(inputs, sizeof(inputs), 1, file) != 1)
+    return false;
+  controls.set_joystick(0, inputs[0]);
+  controls.set_joystick(1, inputs[1]);
+  return true;
+}
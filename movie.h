@@ -0,0 +1,28 @@
+#include <stdint.h>
+#include <stdio.h>
+
+#include "input.h"
+
+#ifndef MOVIE_H
+#define MOVIE_H
+
+// A recording of the controls on every frame, so a run can be played back
+// exactly. Inputs are sampled once at the start of each frame. A movie is a
+// short header followed by one byte per player per frame, holding the
+// Controls::joystick_* bits.
+class Movie {
+  FILE *file;
+  bool recording;
+
+public:
+  // Opens a movie for playback, or starts a new one if |recording| is set.
+  Movie(const char *filename, bool recording);
+  ~Movie();
+
+  // Call at the start of every frame. When recording, saves |controls|. When
+  // playing back, sets |controls| for this frame, and returns false once the
+  // movie runs out.
+  bool next_frame(Controls &controls);
+};
+
+#endif
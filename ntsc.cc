@@ -2,41 +2,144 @@
 
 #include <stdio.h>
 #include <string.h>
-#include <unistd.h>
+#include <thread>
+#include <utility>
 
-NTSC::NTSC(int scale) {
-  display = create_display(visible_columns, visible_scanlines, scale);
-  memset(display->framebuf, 0, visible_columns * visible_scanlines);
+#include "frame_stats.h"
+#include "sound.h"
+
+NTSC::NTSC(int scale, double speed)
+    : NTSC(create_display(visible_columns, visible_scanlines, scale), speed,
+           true) {}
+
+NTSC::NTSC(std::unique_ptr<Display> display, double speed, bool timed) {
+  this->display = std::move(display);
+  this->speed = speed;
+  this->timed = timed;
+
+  if (this->display)
+    memset(this->display->framebuf, 0, visible_columns * visible_scanlines);
 
   gun_x = 0;
   gun_y = 0;
 
-  last_buf_swap = std::chrono::high_resolution_clock::now();
+  pace_start = std::chrono::steady_clock::now();
+}
+
+std::unique_ptr<Display> NTSC::replace_display(
+    std::unique_ptr<Display> display) {
+  std::swap(this->display, display);
+  return display;
+}
+
+void NTSC::save_state(Snapshot &snapshot) {
+  snapshot.frames = frames;
+  snapshot.color_clocks = color_clocks;
+  snapshot.gun_x = gun_x;
+  snapshot.gun_y = gun_y;
+}
+
+void NTSC::load_state(const Snapshot &snapshot) {
+  frames = snapshot.frames;
+  color_clocks = snapshot.color_clocks;
+  gun_x = snapshot.gun_x;
+  gun_y = snapshot.gun_y;
+
+  pace_start = std::chrono::steady_clock::now();
+  pace_start_clocks = color_clocks;
+}
+
+void NTSC::pace(double rate) {
+  auto now = std::chrono::steady_clock::now();
+  auto emulated_us = (int64_t)((color_clocks - pace_start_clocks) /
+                               (color_clock_hz * rate) * 1000000.0);
+  auto target = pace_start + std::chrono::microseconds(emulated_us);
+
+  if (now > target) {
+    int64_t lag_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(now - target)
+            .count();
+    frame_stats.add_late_frame(lag_us);
+    if (lag_us > max_lag_us) {
+      pace_start = now;
+      pace_start_clocks = color_clocks;
+    }
+    return;
+  }
+
+  auto spin_start = target - std::chrono::microseconds((int64_t)spin_us);
+  if (now < spin_start)
+    std::this_thread::sleep_until(spin_start);
+  while (std::chrono::steady_clock::now() < target)
+    ;
+}
+
+void NTSC::pace_audio() {
+  // If the sound card isn't taking samples at all, there's nothing to follow,
+  // so fall back to the host clock. Once we've given up on it, we don't wait
+  // for it again until it starts taking samples.
+  size_t popped = sound_samples.total_popped();
+  if (popped == stalled_popped) {
+    pace(1.0);
+    return;
+  }
+
+  auto last_progress = std::chrono::steady_clock::now();
+  while (true) {
+    int excess = (int)sound_samples.size() - Sound::paced_samples;
+    if (excess <= 0)
+      return;
+
+    // Sleep for as long as the excess takes to play, rather than spinning.
+    // Sound cards take samples in chunks, so it may take a few tries.
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(excess * 1000000LL / Sound::sample_rate));
+
+    auto now = std::chrono::steady_clock::now();
+    if (sound_samples.total_popped() != popped) {
+      popped = sound_samples.total_popped();
+      last_progress = now;
+    } else if (now - last_progress > std::chrono::microseconds(max_lag_us)) {
+      stalled_popped = popped;
+      pace(1.0);
+      return;
+    }
+  }
 }
 
 void NTSC::vsync() {
   gun_y = 0;
 
-  display->swap_buf();
+  // The frame is counted before it's handed over, so the display sees its
+  // number.
+  frames++;
+  if (drawing())
+    display->swap_buf();
+
+  if (!timed)
+    return;
 
-  auto curr_time = std::chrono::high_resolution_clock::now();
-  auto time_in_microseconds =
-      std::chrono::duration_cast<std::chrono::microseconds>(curr_time -
-                                                            last_buf_swap);
-  if (time_in_microseconds.count() < refresh_period_us) {
-    usleep(refresh_period_us - time_in_microseconds.count());
-  } else {
-    printf("Warning! Frame lag! %lu us\n", time_in_microseconds.count());
+  if (speed != 0) {
+    uint64_t wait_start = host_time_ns();
+    if (speed == audio_speed) {
+      pace_audio();
+    } else {
+      pace(speed);
+    }
+    frame_stats.add_wait(host_time_ns() - wait_start);
   }
-  last_buf_swap = std::chrono::high_resolution_clock::now();
+
+  frame_stats.end_frame();
 }
 
 void NTSC::write_pixel(uint8_t pixel) {
   int x = gun_x - hblank;
   int y = gun_y - vblank;
-  if (x >= 0 && x < visible_columns && y >= 0 && y < visible_scanlines)
+  if (drawing() && x >= 0 && x < visible_columns && y >= 0 &&
+      y < visible_scanlines)
     display->framebuf[y * visible_columns + x] = pixel;
 
+  color_clocks++;
   gun_x++;
   if (gun_x >= columns) {
     gun_x = 0;
@@ -44,11 +147,39 @@ void NTSC::write_pixel(uint8_t pixel) {
   }
 }
 
+void NTSC::write_span(const uint8_t *pixels, int count) {
+  int x = gun_x - hblank;
+  int y = gun_y - vblank;
+  if (drawing() && y >= 0 && y < visible_scanlines) {
+    int start = x < 0 ? 0 : x;
+    int end = x + count > visible_columns ? visible_columns : x + count;
+    if (start < end)
+      memcpy(&display->framebuf[y * visible_columns + start],
+             &pixels[start - x], end - start);
+  }
+
+  color_clocks += count;
+  gun_x += count;
+  if (gun_x >= columns) {
+    gun_x = 0;
+    gun_y++;
+  }
+}
+
+void NTSC::write_line(const uint8_t *pixels) {
+  int y = gun_y - vblank;
+  if (drawing() && y >= 0 && y < visible_scanlines)
+    memcpy(&display->framebuf[y * visible_columns], pixels, visible_columns);
+
+  color_clocks += columns;
+  gun_y++;
+}
+
 void NTSC::debug_swap_buf() {
   int x = gun_x - hblank;
   int y = gun_y - vblank;
 
-  if (y < 0 || y > visible_scanlines)
+  if (!drawing() || y < 0 || y > visible_scanlines)
     return;
   if (x < 0 || x >= visible_columns)
     x = 0;
@@ -57,5 +188,9 @@ void NTSC::debug_swap_buf() {
        i++)
     display->framebuf[i] = 0x00;
 
+  // The display hands back a different buffer after every swap, so carry the
+  // partially drawn frame over to it to keep drawing on top of it.
+  uint8_t *partial_frame = display->framebuf;
   display->swap_buf();
+  memcpy(display->framebuf, partial_frame, visible_columns * visible_scanlines);
 }
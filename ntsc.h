@@ -9,7 +9,34 @@
 class NTSC {
   std::unique_ptr<Display> display;
 
-  std::chrono::time_point<std::chrono::high_resolution_clock> last_buf_swap;
+  // Emulation speed as a multiple of real time. 0 means unthrottled, and
+  // |audio_speed| means we follow the sound card.
+  double speed;
+
+  // Whether we pace frames and record frame statistics. When drawing happens
+  // on its own thread, the emulation thread keeps time and the render thread
+  // just draws.
+  bool timed;
+
+  // Pacing is done against emulated time rather than against the previous
+  // frame, so a late frame doesn't push every following frame back with it.
+  // These mark the host time and color clock we are measuring from.
+  std::chrono::steady_clock::time_point pace_start;
+  uint64_t pace_start_clocks = 0;
+
+  // Total color clocks the electron gun has swept since power on.
+  uint64_t color_clocks = 0;
+
+  // Sleep until the host clock catches up with the emulated clock.
+  void pace(double rate);
+
+  // Sleep until the sound card has played enough of what's buffered to make
+  // room for another frame.
+  void pace_audio();
+  // How many samples the sound card had taken when we gave up waiting on it.
+  size_t stalled_popped = SIZE_MAX;
+
+  bool drawing() { return display && draw_frame; }
 
 public:
   const static int columns = 228;
@@ -22,14 +49,40 @@ public:
   const static int visible_columns = 160;
   const static int visible_scanlines = 192;
 
-  // Period in us for 60Hz refresh
-  const static int refresh_period_us = 16666;
+  // NTSC color clock frequency. Each color clock is one pixel.
+  constexpr static double color_clock_hz = 3579545.45;
+
+  // Frames per second, going by a standard 262 scanline frame.
+  constexpr static double frame_hz = color_clock_hz / (columns * scanlines);
+
+  // Passing this as the speed paces emulation by how fast the sound card plays
+  // samples instead of by the host clock. The two drift apart over time, and
+  // following the sound card means its buffer never runs dry or backs up.
+  constexpr static double audio_speed = -1.0;
+
+  // We sleep until this many microseconds before a frame is due and then spin
+  // the rest of the way, since sleep_until can overshoot by a fair amount.
+  const static int spin_us = 250;
+
+  // If we fall this far behind (host stall, sitting at a debugger prompt),
+  // start pacing over from the current time instead of racing to catch up.
+  const static int max_lag_us = 100000;
 
   // Electron gun position
   int gun_x;
   int gun_y;
 
-  NTSC(int scale);
+  // Number of frames since power on
+  uint64_t frames = 0;
+
+  // Whether the current frame is wanted. If not, the gun still sweeps but
+  // nothing is written to the framebuffer and the frame isn't displayed.
+  bool draw_frame = true;
+
+  NTSC(int scale, double speed = 1.0);
+  // |display| may be null, in which case we just keep track of the electron
+  // gun.
+  NTSC(std::unique_ptr<Display> display, double speed, bool timed);
 
   // Resets gun position
   void vsync();
@@ -37,7 +90,31 @@ public:
   // Fires electron gun
   void write_pixel(uint8_t pixel = 0);
 
+  // Fires electron gun |count| times in a row. The span must not run past the
+  // end of the current scanline.
+  void write_span(const uint8_t *pixels, int count);
+
+  // Fires electron gun across a whole scanline. The gun must be at the start
+  // of the scanline, and |pixels| only holds the visible part.
+  void write_line(const uint8_t *pixels);
+
   void debug_swap_buf();
+
+  // Where the electron gun is and how far it has come, so a console can be
+  // picked up from a saved state.
+  struct Snapshot {
+    uint64_t frames;
+    uint64_t color_clocks;
+    int gun_x;
+    int gun_y;
+  };
+  void save_state(Snapshot &snapshot);
+  // Pacing starts over from here.
+  void load_state(const Snapshot &snapshot);
+
+  // Puts |display| in place of the current one, and returns the old one,
+  // which may be null.
+  std::unique_ptr<Display> replace_display(std::unique_ptr<Display> display);
 };
 
 #endif
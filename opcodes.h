@@ -0,0 +1,276 @@
+#include <stdint.h>
+
+#ifndef OPCODES_H
+#define OPCODES_H
+
+// Decoding tables for the 6502 instruction set, shared by the CPU core and the
+// disassembler. Everything here is constexpr so the core can pick each
+// opcode's operation and addressing mode at compile time.
+
+// Instructions, independent of addressing mode. Shift and rotate instructions
+// are divided into accumulator and memory variants, since the accumulator
+// isn't an addressing mode here.
+enum class Op : uint8_t {
+  invalid,
+  ADC,
+  AND,
+  ASL_ACC,
+  ASL_MEMORY,
+  BCC,
+  BCS,
+  BEQ,
+  BIT,
+  BMI,
+  BNE,
+  BPL,
+  BRK,
+  BVC,
+  BVS,
+  CLC,
+  CLD,
+  CLI,
+  CLV,
+  CMP,
+  CPX,
+  CPY,
+  DEC,
+  DEX,
+  DEY,
+  EOR,
+  INC,
+  INX,
+  INY,
+  JMP,
+  JSR,
+  LDA,
+  LDX,
+  LDY,
+  LSR_ACC,
+  LSR_MEMORY,
+  NOP,
+  ORA,
+  PHA,
+  PHP,
+  PLA,
+  PLP,
+  ROL_ACC,
+  ROL_MEMORY,
+  ROR_ACC,
+  ROR_MEMORY,
+  RTI,
+  RTS,
+  SBC,
+  SEC,
+  SED,
+  SEI,
+  STA,
+  STX,
+  STY,
+  TAX,
+  TAY,
+  TSX,
+  TXA,
+  TXS,
+  TYA,
+};
+
+constexpr Op opcode_ops[256] = {
+    Op::BRK,     Op::ORA,     Op::invalid,    Op::invalid,
+    Op::invalid, Op::ORA,     Op::ASL_MEMORY, Op::invalid,
+    Op::PHP,     Op::ORA,     Op::ASL_ACC,    Op::invalid,
+    Op::invalid, Op::ORA,     Op::ASL_MEMORY, Op::invalid,
+    Op::BPL,     Op::ORA,     Op::invalid,    Op::invalid,
+    Op::invalid, Op::ORA,     Op::ASL_MEMORY, Op::invalid,
+    Op::CLC,     Op::ORA,     Op::invalid,    Op::invalid,
+    Op::invalid, Op::ORA,     Op::ASL_MEMORY, Op::invalid,
+    Op::JSR,     Op::AND,     Op::invalid,    Op::invalid,
+    Op::BIT,     Op::AND,     Op::ROL_MEMORY, Op::invalid,
+    Op::PLP,     Op::AND,     Op::ROL_ACC,    Op::invalid,
+    Op::BIT,     Op::AND,     Op::ROL_MEMORY, Op::invalid,
+    Op::BMI,     Op::AND,     Op::invalid,    Op::invalid,
+    Op::invalid, Op::AND,     Op::ROL_MEMORY, Op::invalid,
+    Op::SEC,     Op::AND,     Op::invalid,    Op::invalid,
+    Op::invalid, Op::AND,     Op::ROL_MEMORY, Op::invalid,
+    Op::RTI,     Op::EOR,     Op::invalid,    Op::invalid,
+    Op::invalid, Op::EOR,     Op::LSR_MEMORY, Op::invalid,
+    Op::PHA,     Op::EOR,     Op::LSR_ACC,    Op::invalid,
+    Op::JMP,     Op::EOR,     Op::LSR_MEMORY, Op::invalid,
+    Op::BVC,     Op::EOR,     Op::invalid,    Op::invalid,
+    Op::invalid, Op::EOR,     Op::LSR_MEMORY, Op::invalid,
+    Op::CLI,     Op::EOR,     Op::invalid,    Op::invalid,
+    Op::invalid, Op::EOR,     Op::LSR_MEMORY, Op::invalid,
+    Op::RTS,     Op::ADC,     Op::invalid,    Op::invalid,
+    Op::invalid, Op::ADC,     Op::ROR_MEMORY, Op::invalid,
+    Op::PLA,     Op::ADC,     Op::ROR_ACC,    Op::invalid,
+    Op::JMP,     Op::ADC,     Op::ROR_MEMORY, Op::invalid,
+    Op::BVS,     Op::ADC,     Op::invalid,    Op::invalid,
+    Op::invalid, Op::ADC,     Op::ROR_MEMORY, Op::invalid,
+    Op::SEI,     Op::ADC,     Op::invalid,    Op::invalid,
+    Op::invalid, Op::ADC,     Op::ROR_MEMORY, Op::invalid,
+    Op::invalid, Op::STA,     Op::invalid,    Op::invalid,
+    Op::STY,     Op::STA,     Op::STX,        Op::invalid,
+    Op::DEY,     Op::invalid, Op::TXA,        Op::invalid,
+    Op::STY,     Op::STA,     Op::STX,        Op::invalid,
+    Op::BCC,     Op::STA,     Op::invalid,    Op::invalid,
+    Op::STY,     Op::STA,     Op::STX,        Op::invalid,
+    Op::TYA,     Op::STA,     Op::TXS,        Op::invalid,
+    Op::invalid, Op::STA,     Op::invalid,    Op::invalid,
+    Op::LDY,     Op::LDA,     Op::LDX,        Op::invalid,
+    Op::LDY,     Op::LDA,     Op::LDX,        Op::invalid,
+    Op::TAY,     Op::LDA,     Op::TAX,        Op::invalid,
+    Op::LDY,     Op::LDA,     Op::LDX,        Op::invalid,
+    Op::BCS,     Op::LDA,     Op::invalid,    Op::invalid,
+    Op::LDY,     Op::LDA,     Op::LDX,        Op::invalid,
+    Op::CLV,     Op::LDA,     Op::TSX,        Op::invalid,
+    Op::LDY,     Op::LDA,     Op::LDX,        Op::invalid,
+    Op::CPY,     Op::CMP,     Op::invalid,    Op::invalid,
+    Op::CPY,     Op::CMP,     Op::DEC,        Op::invalid,
+    Op::INY,     Op::CMP,     Op::DEX,        Op::invalid,
+    Op::CPY,     Op::CMP,     Op::DEC,        Op::invalid,
+    Op::BNE,     Op::CMP,     Op::invalid,    Op::invalid,
+    Op::invalid, Op::CMP,     Op::DEC,        Op::invalid,
+    Op::CLD,     Op::CMP,     Op::invalid,    Op::invalid,
+    Op::invalid, Op::CMP,     Op::DEC,        Op::invalid,
+    Op::CPX,     Op::SBC,     Op::invalid,    Op::invalid,
+    Op::CPX,     Op::SBC,     Op::INC,        Op::invalid,
+    Op::INX,     Op::SBC,     Op::NOP,        Op::invalid,
+    Op::CPX,     Op::SBC,     Op::INC,        Op::invalid,
+    Op::BEQ,     Op::SBC,     Op::invalid,    Op::invalid,
+    Op::invalid, Op::SBC,     Op::INC,        Op::invalid,
+    Op::SED,     Op::SBC,     Op::invalid,    Op::invalid,
+    Op::invalid, Op::SBC,     Op::INC,        Op::invalid,
+};
+
+enum class Mode : uint8_t {
+  invalid,
+  implied,
+  immediate,
+  // Branch target, relative to the next instruction.
+  relative,
+  zero_page,
+  zero_page_x,
+  zero_page_y,
+  absolute,
+  absolute_x,
+  absolute_y,
+  // JMP and JSR. The operand is the jump target itself, not the byte there.
+  absolute_jump,
+  // JMP only. The operand points to the jump target.
+  indirect,
+  indirect_x,
+  indirect_y,
+};
+
+// The addressing mode for the given opcode. The opcode matrix is mostly
+// regular, with the low nibble picking the addressing mode, but there are
+// plenty of exceptions.
+constexpr Mode addressing_mode(uint8_t opcode) {
+  uint8_t high_nibble = opcode >> 4;
+  uint8_t low_nibble = opcode & 0xF;
+
+  switch (low_nibble) {
+  case 0:
+    if (high_nibble & 1) {
+      return Mode::relative;
+    } else if (high_nibble == 2) {
+      return Mode::absolute_jump;
+    } else if (high_nibble == 0xA || high_nibble == 0xC || high_nibble == 0xE) {
+      return Mode::immediate;
+    } else if (!high_nibble || high_nibble == 0x4 || high_nibble == 0x6) {
+      return Mode::implied;
+    }
+    break;
+  case 1:
+    return high_nibble & 1 ? Mode::indirect_y : Mode::indirect_x;
+  case 2:
+    if (high_nibble == 0xA)
+      return Mode::immediate;
+    break;
+  case 4:
+    if (high_nibble == 2 || ((high_nibble & 0x8) && !(high_nibble & 1))) {
+      return Mode::zero_page;
+    } else if (high_nibble == 0x9 || high_nibble == 0xB) {
+      return Mode::zero_page_x;
+    }
+    break;
+  case 5:
+    return high_nibble & 1 ? Mode::zero_page_x : Mode::zero_page;
+  case 6:
+    if (high_nibble & 1) {
+      if (high_nibble == 0x9 || high_nibble == 0xB) {
+        return Mode::zero_page_y;
+      } else {
+        return Mode::zero_page_x;
+      }
+    } else {
+      return Mode::zero_page;
+    }
+  case 8:
+    return Mode::implied;
+  case 9:
+    if (high_nibble & 1) {
+      return Mode::absolute_y;
+    } else if (high_nibble != 0x8) {
+      return Mode::immediate;
+    }
+    break;
+  case 0xA:
+    if (!(high_nibble & 0x1) || high_nibble == 0x9 || high_nibble == 0xB)
+      return Mode::implied;
+    break;
+  case 0xC:
+    if (high_nibble == 0x4) {
+      return Mode::absolute_jump;
+    } else if (high_nibble == 0x6) {
+      return Mode::indirect;
+    } else if (high_nibble == 0xB) {
+      return Mode::absolute_x;
+    } else if (high_nibble == 0x2 || high_nibble == 0x8 || high_nibble == 0xA ||
+               high_nibble == 0xC || high_nibble == 0xE) {
+      return Mode::absolute;
+    }
+    break;
+  case 0xD:
+    return high_nibble & 1 ? Mode::absolute_x : Mode::absolute;
+  case 0xE:
+    if (high_nibble == 0x9) {
+      break;
+    } else if (high_nibble == 0xB) {
+      return Mode::absolute_y;
+    } else if (high_nibble & 0x1) {
+      return Mode::absolute_x;
+    } else {
+      return Mode::absolute;
+    }
+  default:
+    break;
+  }
+
+  return Mode::invalid;
+}
+
+// Instruction length in bytes, including the opcode.
+constexpr int insn_len(Mode mode) {
+  switch (mode) {
+  case Mode::invalid:
+  case Mode::implied:
+    return 1;
+  case Mode::absolute:
+  case Mode::absolute_x:
+  case Mode::absolute_y:
+  case Mode::absolute_jump:
+  case Mode::indirect:
+    return 3;
+  default:
+    return 2;
+  }
+}
+
+// Indexed instructions usually take an extra cycle only when indexing crosses
+// a page, but stores and read-modify-write instructions always take it.
+constexpr bool always_extra_cycle(uint8_t opcode) {
+  return opcode == 0x91 || opcode == 0x99 || opcode == 0x9D ||
+         ((opcode & 0x1F) == 0x1E && opcode != 0x9E && opcode != 0xBE);
+}
+
+#endif
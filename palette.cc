@@ -0,0 +1,292 @@
+#include "palette.h"
+
+#include <string.h>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD
+#endif
+
+// NTSC color palette
+// Stored in BGRA format
+// clang-format off
+const uint8_t color_palette[] = {
+    0, 0, 0, 255,
+    0, 68, 68, 255,
+    0, 40, 112, 255,
+    0, 24, 132, 255,
+    0, 0, 136, 255,
+    92, 0, 120, 255,
+    120, 0, 72, 255,
+    132, 0, 20, 255,
+    136, 0, 0, 255,
+    124, 24, 0, 255,
+    92, 44, 0, 255,
+    44, 64, 0, 255,
+    0, 60, 0, 255,
+    0, 56, 20, 255,
+    0, 48, 44, 255,
+    0, 40, 68, 255,
+    64, 64, 64, 255,
+    16, 100, 100, 255,
+    20, 68, 132, 255,
+    24, 52, 152, 255,
+    32, 32, 156, 255,
+    116, 32, 140, 255,
+    144, 32, 96, 255,
+    152, 32, 48, 255,
+    156, 32, 28, 255,
+    144, 56, 28, 255,
+    120, 76, 28, 255,
+    72, 92, 28, 255,
+    32, 92, 32, 255,
+    28, 92, 52, 255,
+    28, 80, 76, 255,
+    24, 72, 100, 255,
+    108, 108, 108, 255,
+    36, 132, 132, 255,
+    40, 92, 152, 255,
+    48, 80, 172, 255,
+    60, 60, 176, 255,
+    136, 60, 160, 255,
+    164, 60, 120, 255,
+    172, 60, 76, 255,
+    176, 64, 56, 255,
+    168, 84, 56, 255,
+    144, 104, 56, 255,
+    100, 124, 56, 255,
+    64, 124, 64, 255,
+    56, 124, 80, 255,
+    52, 112, 104, 255,
+    48, 104, 132, 255,
+    144, 144, 144, 255,
+    52, 160, 160, 255,
+    60, 120, 172, 255,
+    72, 104, 192, 255,
+    88, 88, 192, 255,
+    156, 88, 176, 255,
+    184, 88, 140, 255,
+    192, 88, 104, 255,
+    192, 92, 80, 255,
+    188, 112, 80, 255,
+    172, 132, 80, 255,
+    128, 156, 80, 255,
+    92, 156, 92, 255,
+    80, 152, 108, 255,
+    76, 140, 132, 255,
+    68, 132, 160, 255,
+    176, 176, 176, 255,
+    64, 184, 184, 255,
+    76, 140, 188, 255,
+    92, 128, 208, 255,
+    112, 112, 208, 255,
+    176, 112, 192, 255,
+    204, 112, 160, 255,
+    208, 112, 124, 255,
+    208, 116, 104, 255,
+    204, 136, 104, 255,
+    192, 156, 104, 255,
+    148, 180, 104, 255,
+    116, 180, 116, 255,
+    104, 180, 132, 255,
+    100, 168, 156, 255,
+    88, 156, 184, 255,
+    200, 200, 200, 255,
+    80, 208, 208, 255,
+    92, 160, 204, 255,
+    112, 148, 224, 255,
+    136, 136, 224, 255,
+    192, 132, 208, 255,
+    220, 132, 180, 255,
+    224, 136, 148, 255,
+    224, 140, 124, 255,
+    220, 156, 124, 255,
+    212, 180, 124, 255,
+    172, 208, 124, 255,
+    140, 208, 140, 255,
+    124, 204, 156, 255,
+    120, 192, 180, 255,
+    108, 180, 208, 255,
+    220, 220, 220, 255,
+    92, 232, 232, 255,
+    104, 180, 220, 255,
+    128, 168, 236, 255,
+    160, 160, 236, 255,
+    208, 156, 220, 255,
+    236, 156, 196, 255,
+    236, 160, 168, 255,
+    236, 164, 144, 255,
+    236, 180, 144, 255,
+    232, 204, 144, 255,
+    192, 228, 144, 255,
+    164, 228, 164, 255,
+    144, 228, 180, 255,
+    136, 212, 204, 255,
+    124, 204, 232, 255,
+    236, 236, 236, 255,
+    104, 252, 252, 255,
+    148, 188, 252, 255,
+    180, 180, 252, 255,
+    224, 176, 236, 255,
+    252, 176, 212, 255,
+    252, 180, 188, 255,
+    252, 184, 164, 255,
+    252, 200, 164, 255,
+    252, 224, 164, 255,
+    212, 252, 164, 255,
+    184, 252, 184, 255,
+    164, 252, 200, 255,
+    156, 236, 224, 255,
+    140, 224, 252, 255,
+    255, 255, 255, 255,
+};
+// clang-format on
+
+// Atari color values have the hue in the upper nibble and the luminance in
+// bits 1-3. Our palette is ordered the other way around, so this table folds
+// that bit twiddling into a single lookup per pixel.
+struct BgraTable {
+  uint32_t entries[256];
+
+  BgraTable() {
+    for (int i = 0; i < 256; i++) {
+      int index = ((i & 0x0E) << 3) | ((i & 0xF0) >> 4);
+      entries[i] = ((const uint32_t *)color_palette)[index];
+    }
+  }
+};
+
+const uint32_t *get_bgra_table() {
+  static const BgraTable table;
+  return table.entries;
+}
+
+// Every output row of a frame is identical to the first row of its block, so
+// we only convert once per source row and copy the rest.
+void duplicate_rows(uint32_t *row, int dst_width, int scale) {
+  for (int i = 1; i < scale; i++)
+    memcpy(row + i * dst_width, row, dst_width * sizeof(uint32_t));
+}
+
+void convert_frame_scalar(const uint8_t *src, uint32_t *dst, int width,
+                          int height, int scale) {
+  const uint32_t *table = get_bgra_table();
+  int dst_width = width * scale;
+
+  for (int y = 0; y < height; y++) {
+    uint32_t *out = dst + (size_t)y * scale * dst_width;
+    for (int x = 0; x < width; x++) {
+      uint32_t pixel = table[src[y * width + x]];
+      for (int i = 0; i < scale; i++)
+        *out++ = pixel;
+    }
+    duplicate_rows(dst + (size_t)y * scale * dst_width, dst_width, scale);
+  }
+}
+
+#ifdef HAVE_X86_SIMD
+
+// Converts 8 pixels at a time with a gather, then spreads them across |scale|
+// output vectors with lane permutes.
+__attribute__((target("avx2"))) void
+convert_frame_avx2(const uint8_t *src, uint32_t *dst, int width, int height,
+                   int scale) {
+  const int *table = (const int *)get_bgra_table();
+  int dst_width = width * scale;
+
+  // Output pixel i of chunk k comes from source pixel (8k + i) / scale.
+  std::vector<int> spread(8 * scale);
+  for (int i = 0; i < 8 * scale; i++)
+    spread[i] = i / scale;
+
+  for (int y = 0; y < height; y++) {
+    const uint8_t *row = src + y * width;
+    uint32_t *out = dst + (size_t)y * scale * dst_width;
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+      __m256i indices =
+          _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(row + x)));
+      __m256i pixels = _mm256_i32gather_epi32(table, indices, 4);
+      if (scale == 1) {
+        _mm256_storeu_si256((__m256i *)(out + x), pixels);
+        continue;
+      }
+      for (int k = 0; k < scale; k++) {
+        __m256i lanes = _mm256_loadu_si256((const __m256i *)&spread[8 * k]);
+        _mm256_storeu_si256((__m256i *)(out + x * scale + 8 * k),
+                            _mm256_permutevar8x32_epi32(pixels, lanes));
+      }
+    }
+    for (; x < width; x++) {
+      for (int i = 0; i < scale; i++)
+        out[x * scale + i] = table[row[x]];
+    }
+
+    duplicate_rows(out, dst_width, scale);
+  }
+}
+
+// SSE has no gather, so the lookups are scalar, but the upscale is still done
+// 4 pixels at a time with byte shuffles.
+__attribute__((target("sse4.1"))) void
+convert_frame_sse41(const uint8_t *src, uint32_t *dst, int width, int height,
+                    int scale) {
+  const uint32_t *table = get_bgra_table();
+  int dst_width = width * scale;
+
+  // Byte shuffle controls. Output pixel i of chunk k comes from source pixel
+  // (4k + i) / scale.
+  std::vector<uint8_t> spread(16 * scale);
+  for (int i = 0; i < 4 * scale; i++) {
+    for (int j = 0; j < 4; j++)
+      spread[4 * i + j] = 4 * (i / scale) + j;
+  }
+
+  for (int y = 0; y < height; y++) {
+    const uint8_t *row = src + y * width;
+    uint32_t *out = dst + (size_t)y * scale * dst_width;
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+      __m128i pixels = _mm_setr_epi32(table[row[x]], table[row[x + 1]],
+                                      table[row[x + 2]], table[row[x + 3]]);
+      if (scale == 1) {
+        _mm_storeu_si128((__m128i *)(out + x), pixels);
+        continue;
+      }
+      for (int k = 0; k < scale; k++) {
+        __m128i control = _mm_loadu_si128((const __m128i *)&spread[16 * k]);
+        _mm_storeu_si128((__m128i *)(out + x * scale + 4 * k),
+                         _mm_shuffle_epi8(pixels, control));
+      }
+    }
+    for (; x < width; x++) {
+      for (int i = 0; i < scale; i++)
+        out[x * scale + i] = table[row[x]];
+    }
+
+    duplicate_rows(out, dst_width, scale);
+  }
+}
+
+#endif
+
+void convert_frame(const uint8_t *src, uint32_t *dst, int width, int height,
+                   int scale) {
+#ifdef HAVE_X86_SIMD
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  static const bool has_sse41 = __builtin_cpu_supports("sse4.1");
+
+  if (has_avx2) {
+    convert_frame_avx2(src, dst, width, height, scale);
+    return;
+  } else if (has_sse41) {
+    convert_frame_sse41(src, dst, width, height, scale);
+    return;
+  }
+#endif
+
+  convert_frame_scalar(src, dst, width, height, scale);
+}
@@ -0,0 +1,16 @@
+#include <stdint.h>
+
+#ifndef PALETTE_H
+#define PALETTE_H
+
+// NTSC color palette, 128 colors stored in BGRA format.
+extern const uint8_t color_palette[];
+
+// Converts a |width| x |height| frame of Atari NTSC color values to BGRA,
+// blowing every pixel up into a |scale| x |scale| block on the way. |dst| must
+// have room for width * height * scale * scale pixels. Uses AVX2 or SSE4.1 when
+// the host supports them.
+void convert_frame(const uint8_t *src, uint32_t *dst, int width, int height,
+                   int scale);
+
+#endif
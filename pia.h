@@ -1,32 +1,43 @@
 #include <stdint.h>
 
-#include "memory.h"
+#include "input.h"
 
 #ifndef PIA_H
 #define PIA_H
 
 class PIA {
-  std::shared_ptr<MappedRegion> memory_region;
-
-  uint8_t memory_read_hook(uint16_t addr);
-  void memory_write_hook(uint16_t addr, uint8_t val);
-
-  bool timer_needs_started = false;
-  uint64_t last_process_cycle_num = 0;
-  int interval = 1024;
-
-  bool underflow_since_read = false;
-  bool underflow_since_write = false;
-
-  void process_clock_tick();
-
 public:
-  uint8_t timer = 0;
-  int cycle_counter = 0;
+  // The timer. A console keeps this with the rest of its state, so a PIA is
+  // handed a block of its own when it's built, the same as the CPU's cycle
+  // counter. The PIA puts it in its power on state.
+  struct Registers {
+    // The CPU cycle we have processed up to.
+    uint64_t last_process_cycle_num = 0;
+    int interval = 1024;
+    int cycle_counter = 0;
+    uint8_t timer = 0;
+    bool timer_needs_started = false;
+    bool underflow_since_read = false;
+    bool underflow_since_write = false;
+    uint8_t padding[4] = {0};
+  };
+
+private:
+  Registers &regs;
+  // The CPU's cycle counter, which drives the timer.
+  uint64_t &cycle_num;
+  // The joysticks, which are read through SWCHA.
+  const Controls &controls;
+
+  void process_clock_ticks(uint64_t cycles);
 
-  PIA();
+public:
+  PIA(Registers &regs, uint64_t &cycle_num, const Controls &controls);
 
-  std::shared_ptr<MappedRegion> get_memory_region() { return memory_region; }
+  // Register reads and writes from the bus. These return false if there's no
+  // register at |addr|, and leave it to the bus to complain.
+  bool memory_read_hook(uint16_t addr, uint8_t &val);
+  bool memory_write_hook(uint16_t addr, uint8_t val);
 
   // Process outstanding PIA cycles
   void process_pia();
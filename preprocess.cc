@@ -0,0 +1,309 @@
+#include "preprocess.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ntsc.h"
+#include "palette.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD
+#endif
+
+const static int frame_width = NTSC::visible_columns;
+const static int frame_height = NTSC::visible_scanlines;
+const static int frame_size = frame_width * frame_height;
+
+// Gray level of every palette entry, in palette order. The palette is ordered
+// by luminance and then hue, so each run of 16 is one luminance with every
+// hue, which is just the right size for a byte shuffle.
+struct GrayPalette {
+  uint8_t entries[128];
+
+  GrayPalette() {
+    for (int i = 0; i < 128; i++) {
+      const uint8_t *bgra = &color_palette[i * 4];
+      // OpenCV's fixed point RGB to gray weights.
+      entries[i] = (bgra[2] * 4899 + bgra[1] * 9617 + bgra[0] * 1868 + 8192) >>
+                   14;
+    }
+  }
+};
+
+static PreprocessIsa isa_limit = preprocess_avx2;
+
+void limit_preprocess_isa(PreprocessIsa isa) { isa_limit = isa; }
+
+bool parse_preprocess_isa(const char *name, PreprocessIsa &isa) {
+  if (!strcmp(name, "avx2"))
+    isa = preprocess_avx2;
+  else if (!strcmp(name, "sse4.1"))
+    isa = preprocess_sse41;
+  else if (!strcmp(name, "none"))
+    isa = preprocess_scalar;
+  else
+    return false;
+  return true;
+}
+
+const uint8_t *get_gray_palette() {
+  static const GrayPalette palette;
+  return palette.entries;
+}
+
+// Same bit twiddling as the BGRA table in palette.cc, the hue is in the upper
+// nibble of an Atari color and the luminance in bits 1-3.
+uint8_t gray_level(const uint8_t *palette, uint8_t color) {
+  return palette[((color & 0x0E) << 3) | (color >> 4)];
+}
+
+AreaTaps::AreaTaps(int src_size, int dst_size) {
+  // An output pixel spans src_size / dst_size source pixels, which can
+  // straddle one more than that.
+  taps = std::min(src_size, (src_size + dst_size - 1) / dst_size + 1);
+  first.resize(dst_size);
+  weights.resize(dst_size * taps);
+
+  // Measured in 256ths of an output pixel, source pixel i starts at
+  // i * 256 * dst_size / src_size. Rounding the edges rather than the widths
+  // keeps each output's weights adding up to exactly 256.
+  auto edge = [&](int i) {
+    return (i * 256 * dst_size + src_size / 2) / src_size;
+  };
+  for (int i = 0; i < dst_size; i++) {
+    int start = i * 256;
+    int end = start + 256;
+    first[i] = i * src_size / dst_size;
+    while (edge(first[i] + 1) <= start)
+      first[i]++;
+    // Outputs at the far edge start early instead of running off the end,
+    // with zero weights for the extra pixels up front.
+    int skip = std::max(0, first[i] + taps - src_size);
+    first[i] -= skip;
+    for (int t = skip; t < taps; t++) {
+      int src = first[i] + t;
+      weights[i * taps + t] = std::max(
+          0, std::min(edge(src + 1), end) - std::max(edge(src), start));
+    }
+  }
+
+  // Anything less and flat areas would come out darker, anything more and
+  // the sums could overflow.
+  for (int i = 0; i < dst_size; i++) {
+    int sum = 0;
+    for (int t = 0; t < taps; t++)
+      sum += weights[i * taps + t];
+    if (sum != 256) {
+      printf("Error! Shrinking %d to %d, output %d is weighted %d/256\n",
+             src_size, dst_size, i, sum);
+      exit(-1);
+    }
+  }
+}
+
+// Returns |width|, so it can be checked before the taps are worked out from
+// it, which can't be done for sizes that don't fit.
+static int check_observation_size(int width, int height) {
+  if (width <= 0 || width > frame_width || height <= 0 ||
+      height > frame_height) {
+    printf("Error! Observations can't be %dx%d, they have to fit in %dx%d\n",
+           width, height, frame_width, frame_height);
+    exit(-1);
+  }
+  return width;
+}
+
+Preprocessor::Preprocessor(int width, int height)
+    : width(check_observation_size(width, height)), height(height),
+      row_taps(frame_height, height), column_taps(frame_width, width) {
+  pooled.resize(frame_size);
+  rows.resize(height * frame_width);
+}
+
+void pool_gray_scalar(const uint8_t *frame, const uint8_t *prev_frame,
+                      uint8_t *dst) {
+  const uint8_t *palette = get_gray_palette();
+  if (!prev_frame) {
+    for (int i = 0; i < frame_size; i++)
+      dst[i] = gray_level(palette, frame[i]);
+    return;
+  }
+  for (int i = 0; i < frame_size; i++)
+    dst[i] = std::max(gray_level(palette, frame[i]),
+                      gray_level(palette, prev_frame[i]));
+}
+
+void shrink_rows_scalar(const uint8_t *src, uint16_t *dst,
+                        const AreaTaps &taps, int height) {
+  for (int y = 0; y < height; y++) {
+    uint16_t *out = dst + y * frame_width;
+    const uint16_t *weights = &taps.weights[y * taps.taps];
+    for (int x = 0; x < frame_width; x++) {
+      uint16_t sum = 0;
+      for (int t = 0; t < taps.taps; t++)
+        sum += src[(taps.first[y] + t) * frame_width + x] * weights[t];
+      out[x] = sum;
+    }
+  }
+}
+
+#ifdef HAVE_X86_SIMD
+
+// Looks up 16 colors at once, with one byte shuffle by hue for each of the 8
+// luminances, keeping the lanes whose luminance matches.
+__attribute__((target("sse4.1"))) __m128i gray_sse41(const __m128i *tables,
+                                                     __m128i colors) {
+  __m128i hues =
+      _mm_and_si128(_mm_srli_epi16(colors, 4), _mm_set1_epi8(0x0F));
+  __m128i lumas = _mm_and_si128(colors, _mm_set1_epi8(0x0E));
+  __m128i result = _mm_setzero_si128();
+  for (int luma = 0; luma < 8; luma++) {
+    __m128i match = _mm_cmpeq_epi8(lumas, _mm_set1_epi8(luma << 1));
+    result = _mm_or_si128(
+        result, _mm_and_si128(match, _mm_shuffle_epi8(tables[luma], hues)));
+  }
+  return result;
+}
+
+__attribute__((target("sse4.1"))) void
+pool_gray_sse41(const uint8_t *frame, const uint8_t *prev_frame,
+                uint8_t *dst) {
+  __m128i tables[8];
+  for (int luma = 0; luma < 8; luma++)
+    tables[luma] =
+        _mm_loadu_si128((const __m128i *)&get_gray_palette()[luma * 16]);
+
+  for (int i = 0; i < frame_size; i += 16) {
+    __m128i pixels =
+        gray_sse41(tables, _mm_loadu_si128((const __m128i *)(frame + i)));
+    if (prev_frame) {
+      pixels = _mm_max_epu8(
+          pixels, gray_sse41(tables, _mm_loadu_si128(
+                                         (const __m128i *)(prev_frame + i))));
+    }
+    _mm_storeu_si128((__m128i *)(dst + i), pixels);
+  }
+}
+
+// Sums up every row an output row covers, 8 columns at a time.
+__attribute__((target("sse4.1"))) void
+shrink_rows_sse41(const uint8_t *src, uint16_t *dst, const AreaTaps &taps,
+                  int height) {
+  for (int y = 0; y < height; y++) {
+    uint16_t *out = dst + y * frame_width;
+    const uint16_t *weights = &taps.weights[y * taps.taps];
+    for (int x = 0; x < frame_width; x += 8) {
+      __m128i sum = _mm_setzero_si128();
+      for (int t = 0; t < taps.taps; t++) {
+        __m128i pixels = _mm_cvtepu8_epi16(_mm_loadl_epi64(
+            (const __m128i *)(src + (taps.first[y] + t) * frame_width + x)));
+        sum = _mm_add_epi16(
+            sum, _mm_mullo_epi16(pixels, _mm_set1_epi16(weights[t])));
+      }
+      _mm_storeu_si128((__m128i *)(out + x), sum);
+    }
+  }
+}
+
+__attribute__((target("avx2"))) __m256i gray_avx2(const __m256i *tables,
+                                                  __m256i colors) {
+  __m256i hues =
+      _mm256_and_si256(_mm256_srli_epi16(colors, 4), _mm256_set1_epi8(0x0F));
+  __m256i lumas = _mm256_and_si256(colors, _mm256_set1_epi8(0x0E));
+  __m256i result = _mm256_setzero_si256();
+  for (int luma = 0; luma < 8; luma++) {
+    __m256i match = _mm256_cmpeq_epi8(lumas, _mm256_set1_epi8(luma << 1));
+    result = _mm256_or_si256(
+        result,
+        _mm256_and_si256(match, _mm256_shuffle_epi8(tables[luma], hues)));
+  }
+  return result;
+}
+
+// Same as the SSE version, 32 pixels at a time. Byte shuffles only work
+// within each 128-bit half, so both halves get a copy of the table.
+__attribute__((target("avx2"))) void
+pool_gray_avx2(const uint8_t *frame, const uint8_t *prev_frame, uint8_t *dst) {
+  __m256i tables[8];
+  for (int luma = 0; luma < 8; luma++) {
+    tables[luma] = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i *)&get_gray_palette()[luma * 16]));
+  }
+
+  for (int i = 0; i < frame_size; i += 32) {
+    __m256i pixels =
+        gray_avx2(tables, _mm256_loadu_si256((const __m256i *)(frame + i)));
+    if (prev_frame) {
+      pixels = _mm256_max_epu8(
+          pixels,
+          gray_avx2(tables,
+                    _mm256_loadu_si256((const __m256i *)(prev_frame + i))));
+    }
+    _mm256_storeu_si256((__m256i *)(dst + i), pixels);
+  }
+}
+
+__attribute__((target("avx2"))) void
+shrink_rows_avx2(const uint8_t *src, uint16_t *dst, const AreaTaps &taps,
+                 int height) {
+  for (int y = 0; y < height; y++) {
+    uint16_t *out = dst + y * frame_width;
+    const uint16_t *weights = &taps.weights[y * taps.taps];
+    for (int x = 0; x < frame_width; x += 16) {
+      __m256i sum = _mm256_setzero_si256();
+      for (int t = 0; t < taps.taps; t++) {
+        __m256i pixels = _mm256_cvtepu8_epi16(_mm_loadu_si128(
+            (const __m128i *)(src + (taps.first[y] + t) * frame_width + x)));
+        sum = _mm256_add_epi16(
+            sum, _mm256_mullo_epi16(pixels, _mm256_set1_epi16(weights[t])));
+      }
+      _mm256_storeu_si256((__m256i *)(out + x), sum);
+    }
+  }
+}
+
+#endif
+
+static_assert(frame_size % 32 == 0 && frame_width % 16 == 0,
+              "Frames must be made of whole vectors");
+
+void Preprocessor::process(const uint8_t *frame, const uint8_t *prev_frame,
+                           uint8_t *dst) {
+#ifdef HAVE_X86_SIMD
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  static const bool has_sse41 = __builtin_cpu_supports("sse4.1");
+
+  if (has_avx2 && isa_limit >= preprocess_avx2) {
+    pool_gray_avx2(frame, prev_frame, pooled.data());
+    shrink_rows_avx2(pooled.data(), rows.data(), row_taps, height);
+  } else if (has_sse41 && isa_limit >= preprocess_sse41) {
+    pool_gray_sse41(frame, prev_frame, pooled.data());
+    shrink_rows_sse41(pooled.data(), rows.data(), row_taps, height);
+  } else
+#endif
+  {
+    pool_gray_scalar(frame, prev_frame, pooled.data());
+    shrink_rows_scalar(pooled.data(), rows.data(), row_taps, height);
+  }
+
+  // The columns are done one at a time, since their taps don't line up with
+  // vector lanes, but by now there's less than half the frame left. The rows
+  // are in 256ths, and so are the weights. The taps are pulled out into
+  // locals since stores through |dst| could alias anything as far as the
+  // compiler knows.
+  const int *first = column_taps.first.data();
+  const uint16_t *weights = column_taps.weights.data();
+  int taps = column_taps.taps;
+  for (int y = 0; y < height; y++) {
+    const uint16_t *row = &rows[y * frame_width];
+    for (int x = 0; x < width; x++) {
+      uint32_t sum = 0;
+      for (int t = 0; t < taps; t++)
+        sum += row[first[x] + t] * weights[x * taps + t];
+      dst[y * width + x] = (sum + 0x8000) >> 16;
+    }
+  }
+}
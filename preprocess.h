@@ -0,0 +1,69 @@
+#include <stdint.h>
+#include <vector>
+
+#ifndef PREPROCESS_H
+#define PREPROCESS_H
+
+// Which source pixels each output row or column covers when shrinking
+// |src_size| pixels down to |dst_size|, and how much of each, in 256ths.
+// Output i is the |taps| pixels starting at |first|[i], with weights starting
+// at |weights|[i * taps]. Every output has the same number of taps, some of
+// them zero, so the loops over them don't branch differently every time.
+struct AreaTaps {
+  int taps;
+  std::vector<int> first;
+  std::vector<uint16_t> weights;
+
+  AreaTaps(int src_size, int dst_size);
+};
+
+// The vector instructions preprocessing can use, from least to most.
+enum PreprocessIsa {
+  preprocess_scalar,
+  preprocess_sse41,
+  preprocess_avx2,
+};
+
+// Stops every Preprocessor from using anything past |isa|, even where the host
+// supports it, for checking the vector code against the plain version and
+// timing them. Has to be called before any preprocessing starts.
+void limit_preprocess_isa(PreprocessIsa isa);
+
+// Looks up an instruction set by its command line name, "avx2", "sse4.1" or
+// "none". Returns false if there's no such set.
+bool parse_preprocess_isa(const char *name, PreprocessIsa &isa);
+
+// Turns frames into the observations Atari agents are usually trained on:
+// grayscale, with every pixel the brighter of the last two frames so sprites
+// that flicker between frames don't vanish, and shrunk down to something like
+// 84x84. Doing it here means only the small observation has to leave the
+// emulator.
+//
+// Gray levels are the luminance of the NTSC palette, weighted like OpenCV's
+// RGB to gray. Shrinking averages the area each output pixel covers, like
+// OpenCV's INTER_AREA, in fixed point so every host gets exactly the same
+// bytes. Uses AVX2 or SSE4.1 when the host supports them.
+class Preprocessor {
+  int width;
+  int height;
+
+  AreaTaps row_taps;
+  AreaTaps column_taps;
+
+  // Scratch space. The pooled grayscale frame, and the frame shrunk down to
+  // |height| rows, in 256ths of a gray level.
+  std::vector<uint8_t> pooled;
+  std::vector<uint16_t> rows;
+
+public:
+  Preprocessor(int width = 84, int height = 84);
+
+  // Writes the observation for |frame| into |dst|, which holds width * height
+  // bytes. |prev_frame| is the frame before, or null to not pool. Both are
+  // NTSC::visible_columns x NTSC::visible_scanlines palette indices.
+  void process(const uint8_t *frame, const uint8_t *prev_frame, uint8_t *dst);
+
+  int observation_size() { return width * height; }
+};
+
+#endif
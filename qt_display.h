@@ -1,16 +1,34 @@
 #include "display.h"
+#include "triple_buffer.h"
 
+#include <QAudioOutput>
+#include <QEvent>
+#include <QIODevice>
+#include <QImage>
 #include <QPainter>
-#include <QSoundEffect>
 #include <QWidget>
 #include <atomic>
 #include <memory>
-#include <mutex>
 #include <vector>
 
 #ifndef QT_DISPLAY_H
 #define QT_DISPLAY_H
 
+// Hands synthesized audio to QT5, which pulls from it whenever the sound card
+// wants more.
+class SoundStream : public QIODevice {
+  // If the emulator falls behind, we hold the last sample rather than going
+  // silent, which would click.
+  int16_t last_sample = 0;
+
+protected:
+  qint64 readData(char *data, qint64 max_len) override;
+  qint64 writeData(const char *data, qint64 len) override;
+
+public:
+  bool isSequential() const override { return true; }
+};
+
 class QtDisplay : public Display, public QWidget {
   int width;
   int height;
@@ -19,41 +37,40 @@ class QtDisplay : public Display, public QWidget {
   // modern monitor, so we upscale.
   int scale;
 
-  // This is the framebuffer in actual BGRA format, which QT5 can interpret as a
-  // bitmap and display to the screen. Note that we need mutexes here because
-  // QT5 runs in a separate thread from the main emulator.
-  std::mutex framebuf_mutex;
-  uint8_t *actual_framebuf;
+  // Raw Atari frames on their way from the emulation thread to the QT5 thread.
+  // The emulation thread always draws into the back buffer, so |framebuf|
+  // follows it around.
+  TripleBuffer frames;
 
-  // This signals to the QT5 thread that we need a repaint. This is just poll'd
-  // by the QT5 thread every few milliseconds and is set by the emulation
-  // thread.
-  std::atomic<bool> needs_repaint;
+  // This is the framebuffer in actual BGRA format, already scaled up to the
+  // window size, which QT5 can interpret as a bitmap and display to the screen.
+  // |image| wraps it once up front so painting is a plain blit. Only the QT5
+  // thread ever touches it.
+  uint8_t *actual_framebuf;
+  std::unique_ptr<QImage> image;
 
-  // Sound effects for each channel
-  std::shared_ptr<QSoundEffect> channel0 = nullptr;
-  std::shared_ptr<QSoundEffect> channel1 = nullptr;
-  int prev_volume0 = 0;
-  int prev_volume1 = 0;
+  // Posted to the QT5 thread by the emulation thread whenever a new frame is
+  // ready. |frame_event_pending| keeps us from flooding the event queue if the
+  // QT5 thread falls behind, since it only ever wants the newest frame anyway.
+  static const QEvent::Type frame_event_type;
+  std::atomic<bool> frame_event_pending;
 
-  // This is a convenient hash value that combines frequency and waveform
-  // values. A change in these values means we need to update the sound
-  // channels.
-  int channel0_index = 0;
-  int channel1_index = 0;
+  // Audio output in pull mode. QT5 reads from |sound_stream| on its own.
+  SoundStream sound_stream;
+  std::unique_ptr<QAudioOutput> audio_output;
 
-  // Convert from Atari NTSC to proper BGRA.
-  void convert_framebufs();
+  // Convert the newest published frame from Atari NTSC to proper BGRA, scaling
+  // up as we go. Returns false and does nothing if there's no new frame.
+  bool convert_framebufs();
 
-  // Update all the sound effects.
-  void handle_sound_channel_update(std::shared_ptr<QSoundEffect> &channel,
-                                   int &channel_index, int &prev_volume,
-                                   int volume, int freq, int noise_control);
-  void handle_sound_updates();
+  // Step through drawing every frame, 1 in 2, 1 in 4, 1 in 8, and none,
+  // unless |drawing_required|.
+  const static int max_frameskip = 8;
+  void cycle_frameskip();
 
 protected:
   void paintEvent(QPaintEvent *e) override;
-  void timerEvent(QTimerEvent *e) override;
+  void customEvent(QEvent *e) override;
   void keyPressEvent(QKeyEvent *e) override;
   void keyReleaseEvent(QKeyEvent *e) override;
 
@@ -0,0 +1,43 @@
+#include "sample_ring.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+SampleRing::SampleRing(size_t capacity) {
+  samples = (int16_t *)calloc(capacity, sizeof(int16_t));
+  mask = capacity - 1;
+  head = 0;
+  tail = 0;
+}
+
+SampleRing::~SampleRing() { free(samples); }
+
+size_t SampleRing::push(const int16_t *src, size_t count) {
+  size_t write = head.load(std::memory_order_relaxed);
+  size_t read = tail.load(std::memory_order_acquire);
+  count = std::min(count, capacity() - (write - read));
+
+  // Copy in at most two pieces, either side of the end of the buffer.
+  size_t start = write & mask;
+  size_t first = std::min(count, capacity() - start);
+  memcpy(samples + start, src, first * sizeof(int16_t));
+  memcpy(samples, src + first, (count - first) * sizeof(int16_t));
+
+  head.store(write + count, std::memory_order_release);
+  return count;
+}
+
+size_t SampleRing::pop(int16_t *dst, size_t count) {
+  size_t read = tail.load(std::memory_order_relaxed);
+  size_t write = head.load(std::memory_order_acquire);
+  count = std::min(count, write - read);
+
+  size_t start = read & mask;
+  size_t first = std::min(count, capacity() - start);
+  memcpy(dst, samples + start, first * sizeof(int16_t));
+  memcpy(dst + first, samples, (count - first) * sizeof(int16_t));
+
+  tail.store(read + count, std::memory_order_release);
+  return count;
+}
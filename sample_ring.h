@@ -0,0 +1,45 @@
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+// Lock-free ring buffer of audio samples for one producer thread and one
+// consumer thread. Each side only ever writes its own counter, so neither side
+// waits on the other. The counters count every sample ever pushed or popped,
+// and are masked down to an index on the way into the buffer.
+class SampleRing {
+  int16_t *samples;
+  size_t mask;
+
+  std::atomic<size_t> head;
+  std::atomic<size_t> tail;
+
+public:
+  // |capacity| must be a power of two.
+  SampleRing(size_t capacity);
+  ~SampleRing();
+
+  // Producer side. Copies in as many of |count| samples as there's room for
+  // and returns how many that was.
+  size_t push(const int16_t *src, size_t count);
+
+  // Consumer side. Copies out up to |count| samples and returns how many that
+  // was.
+  size_t pop(int16_t *dst, size_t count);
+
+  // Number of samples waiting for the consumer. Either side may call this, but
+  // it can be out of date by the time it returns.
+  size_t size() {
+    return head.load(std::memory_order_acquire) -
+           tail.load(std::memory_order_acquire);
+  }
+
+  size_t capacity() { return mask + 1; }
+
+  // Total number of samples the consumer has ever popped.
+  size_t total_popped() { return tail.load(std::memory_order_acquire); }
+};
+
+#endif
@@ -0,0 +1,13 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#ifndef SHA256_H
+#define SHA256_H
+
+// SHA-256 of |size| bytes at |data|, as 64 lowercase hex digits. For naming
+// things that are saved to disk by what they came from, where FNV-1a's 64
+// bits aren't enough to rule out two ROMs ever colliding.
+std::string sha256_hex(const void *data, size_t size);
+
+#endif
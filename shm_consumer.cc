@@ -0,0 +1,201 @@
+// Reads the frames "check2600 --shm" publishes, as they come, and optionally
+// plays the game with random joystick input. Shows how to use shm_frames.h,
+// and checks the whole round trip, e.g.
+//
+//   ./check2600 -w /dev/null -x 600 --shm /check2600 --lockstep -f game.bin &
+//   ./shm_consumer -i -n 600 /check2600
+
+#include <atomic>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "frame_stats.h"
+#include "shm_frames.h"
+
+// How long to wait for the emulator to set up the segment.
+const static int attach_timeout_ms = 10000;
+const static int retry_ms = 10;
+
+void print_usage_and_exit() {
+  printf("Usage: shm_consumer [-n frames] [-i] [-w hashes.txt] <name>\n");
+  printf("-n: Stop after reading the given frame. Default is to read until\n");
+  printf("    the emulator exits.\n");
+  printf("-i: Send random joystick input for player 0 after every frame.\n");
+  printf("-w: Write the hash of every frame read to the given file, like\n");
+  printf("    tia_bench -w.\n");
+  printf("-h: Show this help menu and exit.\n");
+  exit(0);
+}
+
+// FNV-1a, the same hash check2600 and tia_bench use.
+uint64_t hash_bytes(const uint8_t *bytes, size_t size) {
+  uint64_t hash = 0xcbf29ce484222325;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+// Waits for the emulator to create and fill in the segment, then maps it.
+SharedFrames *attach(const char *name) {
+  for (int waited_ms = 0; waited_ms < attach_timeout_ms;
+       waited_ms += retry_ms) {
+    int fd = shm_open(name, O_RDWR, 0);
+    struct stat stat_buf;
+    if (fd >= 0 && !fstat(fd, &stat_buf) &&
+        stat_buf.st_size >= (off_t)sizeof(SharedFrames)) {
+      void *mapping = mmap(nullptr, sizeof(SharedFrames),
+                           PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if (mapping == MAP_FAILED) {
+        printf("Error! Could not map shared memory %s\n", name);
+        exit(-1);
+      }
+
+      SharedFrames *shared = (SharedFrames *)mapping;
+      if (shared->magic == shm_frames_magic) {
+        if (shared->version != shm_frames_version ||
+            shared->slot_count != shm_slot_count ||
+            shared->frame_width != shm_frame_width ||
+            shared->frame_height != shm_frame_height) {
+          printf("Error! %s has a different layout than shm_frames.h\n",
+                 name);
+          exit(-1);
+        }
+        return shared;
+      }
+      munmap(mapping, sizeof(SharedFrames));
+    } else if (fd >= 0) {
+      close(fd);
+    }
+    usleep(retry_ms * 1000);
+  }
+
+  printf("Error! Nothing was published to %s\n", name);
+  exit(-1);
+}
+
+int main(int argc, char **argv) {
+  uint64_t frame_limit = 0;
+  bool send_input = false;
+  const char *write_filename = nullptr;
+
+  int c;
+  while ((c = getopt(argc, argv, "hn:iw:")) != -1) {
+    switch (c) {
+    case 'h':
+      print_usage_and_exit();
+      break;
+    case 'n':
+      frame_limit = strtoull(optarg, nullptr, 10);
+      if (!frame_limit) {
+        printf("Error! Invalid frame count %s\n", optarg);
+        exit(-1);
+      }
+      break;
+    case 'i':
+      send_input = true;
+      break;
+    case 'w':
+      write_filename = optarg;
+      break;
+    default:
+      print_usage_and_exit();
+    }
+  }
+
+  if (optind != argc - 1)
+    print_usage_and_exit();
+  const char *name = argv[optind];
+
+  SharedFrames *shared = attach(name);
+  int32_t pid = getpid();
+  shared->consumer_pid = pid;
+
+  std::vector<uint64_t> hashes;
+  uint8_t pixels[shm_frame_width * shm_frame_height];
+  uint8_t ram[shm_ram_size];
+  uint64_t frame_num = 0;
+  uint64_t frames_read = 0;
+  uint64_t missed = 0;
+  uint64_t retries = 0;
+  uint32_t seen = 0;
+  uint32_t rng = 1;
+
+  uint64_t start = host_time_ns();
+  while (!frame_limit || frame_num < frame_limit) {
+    uint32_t published = shared->published;
+    if (published == seen) {
+      if (shared->closed)
+        break;
+      shared->waiting++;
+      futex_wait(shared->published, published, retry_ms);
+      shared->waiting--;
+      continue;
+    }
+
+    // Seqlock read of the newest frame. If the emulator started drawing over
+    // it while we were copying, go around again for whatever's newest now.
+    SharedFrame &frame = shared->slots[(published - 1) % shm_slot_count];
+    uint32_t sequence = frame.sequence.load(std::memory_order_acquire);
+    uint64_t new_frame_num = frame.frame_num;
+    memcpy(pixels, frame.pixels, sizeof(pixels));
+    memcpy(ram, frame.ram, sizeof(ram));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence & 1 ||
+        frame.sequence.load(std::memory_order_relaxed) != sequence) {
+      retries++;
+      continue;
+    }
+
+    if (frames_read)
+      missed += published - seen - 1;
+    seen = published;
+    frame_num = new_frame_num;
+    frames_read++;
+    if (write_filename)
+      hashes.push_back(hash_bytes(pixels, sizeof(pixels)));
+
+    if (send_input) {
+      rng = rng * 1103515245 + 12345;
+      shared->joysticks = (rng >> 16) & 0x1F;
+      shared->input_count++;
+    }
+    if (shared->lockstep) {
+      shared->answered = published;
+      futex_wake(shared->answered);
+    }
+  }
+  uint64_t elapsed_ns = host_time_ns() - start;
+
+  shared->consumer_pid.compare_exchange_strong(pid, 0);
+
+  printf("Read %lu frames in %.2f s, missed %lu, retried %lu torn reads\n",
+         frames_read, elapsed_ns / 1e9, missed, retries);
+
+  if (write_filename) {
+    FILE *file = fopen(write_filename, "w");
+    if (!file) {
+      printf("could not open %s\n", write_filename);
+      exit(-1);
+    }
+    for (uint64_t hash : hashes)
+      fprintf(file, "%016lx\n", hash);
+    fclose(file);
+  }
+
+  if (!frames_read)
+    return 1;
+  printf("RAM hash after %lu frames: %016lx\n", frame_num,
+         hash_bytes(ram, sizeof(ram)));
+
+  return 0;
+}
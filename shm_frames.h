@@ -0,0 +1,94 @@
+#include <atomic>
+#include <linux/futex.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef SHM_FRAMES_H
+#define SHM_FRAMES_H
+
+// Layout of the POSIX shared memory segment that "check2600 --shm" publishes
+// frames to, so other processes can watch the game and play it without any
+// pipes or copies in between. It only depends on the C++ standard library and
+// Linux, so consumers can include it on its own. See shm_consumer.cc.
+//
+// The emulator draws straight into a ring of slots. Each slot is guarded by a
+// seqlock: its sequence is odd while the slot is being drawn, and goes up to
+// the next even number once the frame, RAM, and frame number are all in. To
+// read a slot, load the sequence, copy out what's needed, and load it again.
+// If it was odd or changed, the emulator got to the slot first, so try again
+// with the newest one. Consumers that can't keep up just see fewer frames;
+// the emulator never waits on them unless it's in lockstep.
+
+const static uint32_t shm_frames_magic = 0x30303632; // "2600"
+const static uint32_t shm_frames_version = 1;
+
+const static int shm_frame_width = 160;
+const static int shm_frame_height = 192;
+const static int shm_ram_size = 128;
+const static int shm_slot_count = 4;
+
+struct SharedFrame {
+  std::atomic<uint32_t> sequence;
+  // Frames since power on, counting this one.
+  uint64_t frame_num;
+  uint8_t ram[shm_ram_size];
+  // Colors in the Atari NTSC palette, one byte per pixel, like
+  // Display::framebuf.
+  alignas(64) uint8_t pixels[shm_frame_width * shm_frame_height];
+};
+
+struct SharedFrames {
+  // Written last when the emulator sets the segment up, so a consumer that
+  // attaches early can tell it isn't ready yet.
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  uint32_t slot_count;
+  uint32_t frame_width;
+  uint32_t frame_height;
+
+  // Set when the emulator lets go of the segment.
+  std::atomic<uint32_t> closed;
+
+  // How many frames have been published. The newest one is in slot
+  // (published - 1) % slot_count. Consumers can futex wait on this, and
+  // should count themselves in |waiting| while they do, since the emulator
+  // only bothers to wake anyone if it's nonzero.
+  std::atomic<uint32_t> published;
+  std::atomic<uint32_t> waiting;
+
+  // If set, the emulator waits after every frame until the consumer stores
+  // the value of |published| it has seen in |answered|, and wakes it.
+  uint32_t lockstep;
+  std::atomic<uint32_t> answered;
+  // The consumer's PID, so the emulator can tell if it goes away in the
+  // middle of lockstep.
+  std::atomic<int32_t> consumer_pid;
+
+  // Joystick input from the consumer, one byte per player, player 0 in the
+  // low byte, packed like Controls::get_joystick(). Store it, then bump
+  // |input_count|, and it takes effect from the next frame the emulator
+  // starts.
+  std::atomic<uint32_t> joysticks;
+  std::atomic<uint32_t> input_count;
+
+  SharedFrame slots[shm_slot_count];
+};
+
+// Waits until |word| isn't |val|, or |timeout_ms| goes by. Spurious wakeups
+// are possible, so check again afterwards.
+inline void futex_wait(std::atomic<uint32_t> &word, uint32_t val,
+                       int timeout_ms) {
+  struct timespec timeout = {timeout_ms / 1000,
+                             (timeout_ms % 1000) * 1000000L};
+  syscall(SYS_futex, (uint32_t *)&word, FUTEX_WAIT, val, &timeout, nullptr, 0);
+}
+
+// Wakes everyone waiting on |word|, in any process.
+inline void futex_wake(std::atomic<uint32_t> &word) {
+  syscall(SYS_futex, (uint32_t *)&word, FUTEX_WAKE, INT32_MAX, nullptr,
+          nullptr, 0);
+}
+
+#endif
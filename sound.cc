@@ -1,8 +1,253 @@
 #include "sound.h"
 
-uint8_t volume0 = 0;
-uint8_t freq0 = 0;
-uint8_t noise_control0 = 0;
-uint8_t volume1 = 0;
-uint8_t freq1 = 0;
-uint8_t noise_control1 = 0;
+#include <algorithm>
+
+// Room for about 45ms of samples, though we only ever let
+// |max_buffered_samples| of it fill up.
+SampleRing sound_samples(2048);
+
+// The polynomial counters are linear feedback shift registers. Each step
+// shifts right and feeds the XOR of bit 0 and bit |tap| back in at the top.
+constexpr int step_poly(int poly, int size, int tap) {
+  return (poly >> 1) | (((poly ^ (poly >> tap)) & 1) << (size - 1));
+}
+
+// One bit per step of a polynomial counter, over a full cycle.
+template <int length> struct PolyBits {
+  uint8_t bits[length];
+};
+
+// The counters start out all ones. These are the bits they shift out.
+template <int length>
+constexpr PolyBits<length> make_poly_bits(int size, int tap) {
+  PolyBits<length> table = {};
+  int poly = (1 << size) - 1;
+  for (int i = 0; i < length; i++) {
+    poly = step_poly(poly, size, tap);
+    table.bits[i] = poly & 0x01;
+  }
+  return table;
+}
+
+constexpr PolyBits<15> poly4_bits = make_poly_bits<15>(4, 1);
+constexpr PolyBits<31> poly5_bits = make_poly_bits<31>(5, 2);
+constexpr PolyBits<511> poly9_bits = make_poly_bits<511>(9, 4);
+
+// The divide by 31 modes piggyback on the 5-bit counter, and fire at two
+// points in its cycle.
+constexpr PolyBits<31> make_div31_bits() {
+  PolyBits<31> table = {};
+  int poly = 0x1F;
+  for (int i = 0; i < 31; i++) {
+    poly = step_poly(poly, 5, 2);
+    table.bits[i] = poly == 0x0F || poly == 0x08;
+  }
+  return table;
+}
+
+constexpr PolyBits<31> div31_bits = make_div31_bits();
+
+// AUDCx picks which of the counters drive the output:
+// 0x0, 0xB: Always on, so the output is just the volume.
+// 0x1: 4-bit poly
+// 0x2: Divide by 31, then 4-bit poly
+// 0x3: 5-bit poly, then 4-bit poly
+// 0x4, 0x5: Divide by 2, a pure tone
+// 0x6, 0xA: Divide by 31, a pure tone
+// 0x7: 5-bit poly, then divide by 2
+// 0x8: 9-bit poly, which is white noise
+// 0x9: 5-bit poly
+// 0xC - 0xF: Same as 0x4 - 0x7, but with an extra divide by 3 up front.
+//
+// This is how many times the divider has to fire before each one repeats. The
+// 4-bit counter takes 15 laps of the 5-bit counter to come back around when
+// the two are chained.
+static const int waveform_steps[16] = {1,   15, 465, 465, 2, 2, 31, 31,
+                                       511, 31, 31,  1,   2, 2, 31, 31};
+
+const Sound::Waveform &Sound::get_waveform(int control, int freq) {
+  Waveform &waveform = waveforms[control][freq];
+  if (!waveform.empty())
+    return waveform;
+
+  if (control == 0x0 || control == 0xB) {
+    waveform.push_back(1);
+    return waveform;
+  }
+
+  int period = freq + 1;
+  if ((control & 0xC) == 0xC)
+    period *= 3;
+
+  int steps = waveform_steps[control];
+  waveform.reserve(period * steps);
+
+  int poly4 = 0;
+  int poly5 = 0;
+  int poly9 = 0;
+  uint8_t output = 1;
+  for (int i = 0; i < steps; i++) {
+    // The divider fires on the last clock of each period.
+    waveform.insert(waveform.end(), period - 1, output);
+
+    bool tick;
+    if (!(control & 0x2)) {
+      tick = true;
+    } else if (!(control & 0x1)) {
+      tick = div31_bits.bits[poly5];
+    } else {
+      tick = poly5_bits.bits[poly5];
+    }
+
+    if (tick) {
+      if (control & 0x4) {
+        output ^= 1;
+      } else if (control == 0x8) {
+        output = poly9_bits.bits[poly9];
+        poly9 = (poly9 + 1) % 511;
+      } else if (control & 0x8) {
+        output = poly5_bits.bits[poly5];
+      } else {
+        output = poly4_bits.bits[poly4];
+        poly4 = (poly4 + 1) % 15;
+      }
+    }
+    poly5 = (poly5 + 1) % 31;
+
+    waveform.push_back(output);
+  }
+
+  // Coming back around, the clocks before the first step hold whatever the
+  // last step left behind, which isn't always where we started.
+  std::fill(waveform.begin(), waveform.begin() + period - 1, output);
+
+  return waveform;
+}
+
+// The new waveform starts over from the top. The real chip's counters carry on
+// from wherever they were, but that only changes the texture of the noisier
+// modes a little.
+void Sound::select_waveform(Channel &channel) {
+  const Waveform &waveform = get_waveform(channel.control, channel.freq);
+  channel.waveform = waveform.data();
+  channel.waveform_length = waveform.size();
+  channel.position = 0;
+}
+
+Sound::Sound(uint64_t cycle) {
+  seek(cycle);
+  select_waveform(channels[0]);
+  select_waveform(channels[1]);
+}
+
+void Sound::seek(uint64_t cycle) {
+  next_clock_cycle = (cycle + clock_cycles - 1) / clock_cycles * clock_cycles;
+}
+
+void Sound::save_state(Snapshot &snapshot) {
+  snapshot.next_clock_cycle = next_clock_cycle;
+  for (int i = 0; i < 2; i++) {
+    snapshot.volume[i] = channels[i].volume;
+    snapshot.freq[i] = channels[i].freq;
+    snapshot.control[i] = channels[i].control;
+    snapshot.position[i] = channels[i].position;
+  }
+}
+
+void Sound::load_state(const Snapshot &snapshot) {
+  next_clock_cycle = snapshot.next_clock_cycle;
+  sample_sum = 0;
+  sample_fill = 0;
+  for (int i = 0; i < 2; i++) {
+    channels[i].volume = snapshot.volume[i];
+    channels[i].freq = snapshot.freq[i];
+    channels[i].control = snapshot.control[i];
+    select_waveform(channels[i]);
+    channels[i].position = snapshot.position[i];
+  }
+}
+
+void Sound::match_refresh(double refresh_hz) {
+  if (refresh_hz <= 0)
+    return;
+
+  double rate = NTSC::frame_hz / refresh_hz;
+  if (rate >= 1 - max_rate_adjust && rate <= 1 + max_rate_adjust)
+    clock_samples = sample_rate / clock_hz * rate;
+}
+
+// Games often rewrite the same values every frame, which mustn't restart the
+// waveform.
+void Sound::set_freq(int channel, uint8_t val) {
+  val &= 0x1F;
+  if (val == channels[channel].freq)
+    return;
+  channels[channel].freq = val;
+  select_waveform(channels[channel]);
+}
+
+void Sound::set_control(int channel, uint8_t val) {
+  val &= 0x0F;
+  if (val == channels[channel].control)
+    return;
+  channels[channel].control = val;
+  select_waveform(channels[channel]);
+}
+
+void Sound::catch_up(uint64_t cycle) {
+  if (muted) {
+    seek(cycle + 1);
+    return;
+  }
+
+  while (next_clock_cycle <= cycle) {
+    float level = 0;
+    for (Channel &channel : channels) {
+      level += channel.volume * channel.waveform[channel.position];
+      if (++channel.position == channel.waveform_length)
+        channel.position = 0;
+    }
+    next_clock_cycle += clock_cycles;
+
+    float remaining = clock_samples;
+    while (sample_fill + remaining >= 1) {
+      sample_sum += level * (1 - sample_fill);
+      remaining -= 1 - sample_fill;
+      add_sample(sample_sum);
+      sample_sum = 0;
+      sample_fill = 0;
+    }
+    sample_sum += level * remaining;
+    sample_fill += remaining;
+  }
+
+  flush_batch();
+}
+
+void Sound::start_wav(const char *filename) {
+  wav = std::make_unique<WavWriter>(filename, sample_rate);
+}
+
+void Sound::stop_wav() { wav = nullptr; }
+
+void Sound::add_sample(float sample) {
+  // Both channels at full volume come to 30, which this scales to most of the
+  // int16_t range.
+  batch[batch_count++] = (int16_t)(sample * 1024);
+  if (batch_count == batch_size)
+    flush_batch();
+}
+
+void Sound::flush_batch() {
+  if (wav) {
+    wav->write(batch, batch_count);
+    batch_count = 0;
+    return;
+  }
+
+  int buffered = sound_samples.size();
+  int room =
+      buffered < max_buffered_samples ? max_buffered_samples - buffered : 0;
+  sound_samples.push(batch, batch_count < room ? batch_count : room);
+  batch_count = 0;
+}
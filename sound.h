@@ -1,13 +1,151 @@
+#include <memory>
 #include <stdint.h>
+#include <vector>
+
+#include "ntsc.h"
+#include "sample_ring.h"
+#include "wav_writer.h"
 
 #ifndef SOUND_H
 #define SOUND_H
 
-extern uint8_t volume0;
-extern uint8_t freq0;
-extern uint8_t noise_control0;
-extern uint8_t volume1;
-extern uint8_t freq1;
-extern uint8_t noise_control1;
+// Synthesized samples on their way from the emulation thread to the sound card.
+extern SampleRing sound_samples;
+
+// The TIA's two audio channels. A channel's output only depends on AUDFx and
+// AUDCx, so rather than running the chip's divider and polynomial counters
+// clock by clock, we play back one full period of what they would produce,
+// clocked off of |cycle_num| so register writes take effect on the exact cycle
+// they happen. AUDVx just scales it.
+class Sound {
+  // One full period of a channel's output, one entry per audio clock.
+  typedef std::vector<uint8_t> Waveform;
+
+  // Waveforms by AUDCx and AUDFx, built the first time they're needed.
+  Waveform waveforms[16][32];
+
+  struct Channel {
+    // AUDVx, AUDFx, and AUDCx
+    uint8_t volume = 0;
+    uint8_t freq = 0;
+    uint8_t control = 0;
+
+    // The waveform for |freq| and |control|, and where we are in it.
+    const uint8_t *waveform;
+    int waveform_length;
+    int position = 0;
+  };
+  Channel channels[2];
+
+  // CPU cycle of the next audio clock.
+  uint64_t next_clock_cycle;
+
+  // Resampling from the audio clock to |sample_rate|. Each output sample is the
+  // average of every audio clock it overlaps. |sample_fill| is how much of the
+  // current output sample is covered so far, from 0 to 1. |clock_samples| is
+  // how many output samples one audio clock covers.
+  float clock_samples = sample_rate / clock_hz;
+  float sample_sum = 0;
+  float sample_fill = 0;
+
+  // Set while writing audio to a WAV file instead of the sound card.
+  std::unique_ptr<WavWriter> wav;
+
+  // Set if nobody is listening, in which case nothing gets synthesized.
+  bool muted = false;
+
+  // Samples waiting to be pushed to |sound_samples|.
+  const static int batch_size = 256;
+  int16_t batch[batch_size];
+  int batch_count = 0;
+
+  const Waveform &get_waveform(int control, int freq);
+  // Switch |channel| over to the waveform for its current AUDFx and AUDCx.
+  void select_waveform(Channel &channel);
+
+  void add_sample(float sample);
+  void flush_batch();
+
+public:
+  // The audio clock runs twice a scanline, so every 38 CPU cycles.
+  const static int clock_cycles = 38;
+  constexpr static double clock_hz = NTSC::color_clock_hz / 3 / clock_cycles;
+  const static int sample_rate = 44100;
+
+  // How often the emulation thread hands samples over, in CPU cycles. This is
+  // about 2ms.
+  const static int batch_cycles = 64 * clock_cycles;
+
+  // Emulation runs a frame at a time and then waits, so the ring has to hold a
+  // whole frame's worth of samples on top of |paced_samples|. Anything past
+  // that is dropped rather than being allowed to pile up as latency.
+  const static int max_buffered_samples = 1024;
+
+  // When emulation follows the sound card, it waits for the ring to drain down
+  // to this many samples, about 6ms, before running the next frame. Sound cards
+  // take samples in chunks, so any less than a whole |output_buffer_samples|
+  // and it runs dry while we wait.
+  const static int paced_samples = 256;
+
+  // The most we'll stretch or squeeze the audio to line frames up with the
+  // host's refresh rate.
+  constexpr static double max_rate_adjust = 0.005;
+
+  // How many samples we ask the sound card to buffer on its end, about 5ms.
+  const static int output_buffer_samples = 256;
+
+  Sound(uint64_t cycle);
+
+  // The channels point into |waveforms|, so a Sound can't be copied.
+  Sound(const Sound &) = delete;
+  Sound &operator=(const Sound &) = delete;
+
+  // Pick up synthesizing from |cycle|, skipping everything before it.
+  void seek(uint64_t cycle);
+
+  // When emulation follows the sound card, the number of samples each emulated
+  // second turns into sets the emulation speed. If the host refreshes at close
+  // to |NTSC::frame_hz|, resample slightly so frames come out at exactly its
+  // refresh rate and none get dropped or shown twice.
+  void match_refresh(double refresh_hz);
+
+  // Synthesize every audio clock up to |cycle|.
+  void catch_up(uint64_t cycle);
+
+  // Send every sample to a WAV file instead of the sound card, from here until
+  // stop_wav(). Nothing gets dropped, however far ahead of real time emulation
+  // runs.
+  void start_wav(const char *filename);
+  void stop_wav();
+
+  // Skip synthesizing altogether. |sound_samples| only has room for one
+  // producer, so this is a must for anything running alongside the emulator's
+  // own console.
+  void mute() { muted = true; }
+
+  // Whether enough cycles have gone by since the last catch_up() to be worth
+  // synthesizing another batch.
+  bool batch_due(uint64_t cycle) {
+    return cycle >= next_clock_cycle + batch_cycles;
+  }
+
+  // Everything that decides what gets synthesized from here on, so a console
+  // can be picked up from a saved state. Batched samples aren't included.
+  struct Snapshot {
+    uint64_t next_clock_cycle;
+    uint8_t volume[2];
+    uint8_t freq[2];
+    uint8_t control[2];
+    int position[2];
+  };
+  void save_state(Snapshot &snapshot);
+  void load_state(const Snapshot &snapshot);
+
+  void set_volume(int channel, uint8_t val) {
+    channels[channel].volume = val & 0x0F;
+  }
+  void set_freq(int channel, uint8_t val);
+  void set_control(int channel, uint8_t val);
+};
 
 #endif
@@ -0,0 +1,166 @@
+#include "start_states.h"
+
+#include <errno.h>
+#include <future>
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "display.h"
+#include "input.h"
+#include "sha256.h"
+#include "tia.h"
+
+// A start state file is a short header, the key it was saved under, and the
+// Console::Snapshot as raw bytes. Snapshots are only good for the build that
+// wrote them, so the version needs bumping whenever one changes shape, and the
+// size has to match too.
+static const char start_state_magic[4] = {'C', '2', '6', 'S'};
+static const uint8_t start_state_version = 2;
+
+typedef std::shared_ptr<const Console::Snapshot> StartState;
+
+// Every start state this process has asked for, by key. Whoever asks first
+// works it out, and anybody else asking in the meantime waits on the future.
+static std::mutex start_states_mutex;
+static std::map<std::string, std::shared_future<StartState>> start_states;
+
+static std::string make_key(const RomImage &rom,
+                            const std::vector<uint8_t> &inputs,
+                            uint64_t frames) {
+  std::string key = rom.hash();
+  key += " " + std::to_string(rom.type);
+  key += " " + std::to_string(frames);
+  key += " ";
+  for (uint8_t input : inputs) {
+    char hex[3];
+    snprintf(hex, sizeof(hex), "%02x", input);
+    key += hex;
+  }
+  return key;
+}
+
+static bool read_start_state(const std::string &filename,
+                             const std::string &key,
+                             Console::Snapshot &snapshot) {
+  FILE *file = fopen(filename.c_str(), "rb");
+  if (!file)
+    return false;
+
+  uint8_t header[5];
+  uint32_t key_size;
+  uint32_t snapshot_size;
+  std::string saved_key;
+  bool ok = fread(header, sizeof(header), 1, file) == 1 &&
+            !memcmp(header, start_state_magic, sizeof(start_state_magic)) &&
+            header[4] == start_state_version &&
+            fread(&key_size, sizeof(key_size), 1, file) == 1 &&
+            key_size == key.size();
+  if (ok) {
+    saved_key.resize(key_size);
+    ok = fread(&saved_key[0], key_size, 1, file) == 1 && saved_key == key &&
+         fread(&snapshot_size, sizeof(snapshot_size), 1, file) == 1 &&
+         snapshot_size == sizeof(snapshot) &&
+         fread(&snapshot, sizeof(snapshot), 1, file) == 1;
+  }
+  fclose(file);
+
+  if (!ok)
+    printf("Warning! Ignoring stale start state %s\n", filename.c_str());
+  return ok;
+}
+
+// Written to a temporary file and renamed into place, so other processes
+// starting from the same state never see half of one.
+static void write_start_state(const std::string &filename,
+                              const std::string &key,
+                              const Console::Snapshot &snapshot) {
+  std::string temp_filename = filename + "." + std::to_string(getpid());
+  FILE *file = fopen(temp_filename.c_str(), "wb");
+  if (!file) {
+    printf("Warning! Could not save start state to %s\n", filename.c_str());
+    return;
+  }
+
+  uint8_t header[5];
+  memcpy(header, start_state_magic, sizeof(start_state_magic));
+  header[4] = start_state_version;
+  uint32_t key_size = key.size();
+  uint32_t snapshot_size = sizeof(snapshot);
+  bool ok = fwrite(header, sizeof(header), 1, file) == 1 &&
+            fwrite(&key_size, sizeof(key_size), 1, file) == 1 &&
+            fwrite(key.data(), key_size, 1, file) == 1 &&
+            fwrite(&snapshot_size, sizeof(snapshot_size), 1, file) == 1 &&
+            fwrite(&snapshot, sizeof(snapshot), 1, file) == 1;
+  ok = !fclose(file) && ok;
+
+  if (!ok || rename(temp_filename.c_str(), filename.c_str())) {
+    printf("Warning! Could not save start state to %s\n", filename.c_str());
+    unlink(temp_filename.c_str());
+  }
+}
+
+// Boots the game on a console of its own, with nothing drawn.
+static void boot(std::shared_ptr<const RomImage> rom,
+                 const std::vector<uint8_t> &inputs, uint64_t frames,
+                 Console::Snapshot &snapshot) {
+  Controls controls;
+  Console console(rom, controls);
+  console.tia =
+      std::make_unique<TIA>(console.state.tia, console.state.cpu.cycle_num,
+                            controls, std::unique_ptr<Display>());
+  console.tia->set_drawing(false);
+  console.power_on();
+
+  for (uint64_t frame = 0; frame < frames && console.cpu.should_execute;
+       frame++) {
+    controls.set_joystick(0, frame < inputs.size() ? inputs[frame] : 0);
+    console.run_frame();
+  }
+
+  console.save_state(snapshot);
+}
+
+StartState find_start_state(std::shared_ptr<const RomImage> rom,
+                            const std::vector<uint8_t> &inputs,
+                            uint64_t frames, const char *cache_dir) {
+  std::string key = make_key(*rom, inputs, frames);
+
+  std::shared_future<StartState> future;
+  std::promise<StartState> promise;
+  {
+    std::lock_guard<std::mutex> lock(start_states_mutex);
+    auto it = start_states.find(key);
+    if (it != start_states.end()) {
+      future = it->second;
+    } else {
+      start_states[key] = promise.get_future().share();
+    }
+  }
+  if (future.valid())
+    return future.get();
+
+  // Zeroed, so the padding that goes to disk is always the same.
+  auto snapshot = std::make_shared<Console::Snapshot>();
+
+  std::string filename;
+  if (cache_dir) {
+    if (mkdir(cache_dir, 0755) && errno != EEXIST)
+      printf("Warning! Could not create %s\n", cache_dir);
+    filename = std::string(cache_dir) + "/" +
+               sha256_hex(key.data(), key.size()) + ".state";
+  }
+
+  if (!cache_dir || !read_start_state(filename, key, *snapshot)) {
+    boot(rom, inputs, frames, *snapshot);
+    if (cache_dir)
+      write_start_state(filename, key, *snapshot);
+  }
+
+  promise.set_value(snapshot);
+  return snapshot;
+}
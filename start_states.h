@@ -0,0 +1,29 @@
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "bank_switchers.h"
+#include "console.h"
+
+#ifndef START_STATES_H
+#define START_STATES_H
+
+// Games can take hundreds of frames to boot before they're playable, so rather
+// than having every episode sit through that, consoles can start from a saved
+// state instead. Start states are keyed by the ROM's SHA-256, its bank
+// switching type, the inputs held while booting, and how many frames in the
+// state is.
+//
+// Returns the state of a console running |rom| |frames| frames after power on,
+// with player 0's joystick held at |inputs|[i] on frame i, and let go once
+// they run out. Each start state is only worked out once per process, the
+// first time anybody asks for it, and everybody who asks for it after that
+// shares the same copy, which nothing ever changes. If |cache_dir| is set,
+// start states are also saved there, and loaded from there instead of booting
+// the game when they've been saved before.
+std::shared_ptr<const Console::Snapshot>
+find_start_state(std::shared_ptr<const RomImage> rom,
+                 const std::vector<uint8_t> &inputs, uint64_t frames,
+                 const char *cache_dir);
+
+#endif
@@ -0,0 +1,204 @@
+; Moves every object around with HMOVE and RESM1 so they keep running into
+; each other and the playfield, and keeps track of the collision registers in
+; RAM. Collisions are read once in the middle of the picture, where they have
+; to be worked out up to the current pixel, and for all of them at the end of
+; the frame before CXCLR. Skipping or pipelining frames must not change any of
+; this, which is what "make frameskip_test" checks.
+
+VSYNC = 0x00
+VBLANK = 0x01
+WSYNC = 0x02
+NUSIZ0 = 0x04
+NUSIZ1 = 0x05
+COLUP0 = 0x06
+COLUP1 = 0x07
+COLUPF = 0x08
+COLUBK = 0x09
+CTRLPF = 0x0A
+PF1 = 0x0E
+RESP0 = 0x10
+RESP1 = 0x11
+RESM0 = 0x12
+RESM1 = 0x13
+RESBL = 0x14
+GRP0 = 0x1B
+GRP1 = 0x1C
+ENAM0 = 0x1D
+ENAM1 = 0x1E
+ENABL = 0x1F
+HMP0 = 0x20
+HMP1 = 0x21
+HMM0 = 0x22
+HMM1 = 0x23
+HMBL = 0x24
+HMOVE = 0x2A
+CXCLR = 0x2C
+CXM0P = 0x30
+CXPPMM = 0x37
+
+; RAM
+FRAME_COUNT = 0x80
+; Collision bits of the last four frames, one byte per collision register
+CX_HISTORY = 0x90
+; Number of frames each collision bit was set for
+CX_BIT7_COUNT = 0xA0
+CX_BIT6_COUNT = 0xB0
+; Number of frames the players had already collided by the middle line
+MID_FRAME_COUNT = 0xC0
+
+MID_LINE = 96
+
+
+ROM_START=0xF000
+RESET_VECTOR=0xFFFC
+
+*=ROM_START
+; Clear RAM
+ldx #0
+lda #0
+CLEAR_RAM:
+sta 0x80,x
+inx
+bpl CLEAR_RAM
+
+lda #0x13
+sta NUSIZ0
+lda #0x25
+sta NUSIZ1
+lda #0x21
+sta CTRLPF
+lda #0x1E
+sta COLUP0
+lda #0x44
+sta COLUP1
+lda #0x86
+sta COLUPF
+lda #0x00
+sta COLUBK
+
+; Spread the objects out, then give each one its own speed
+sta WSYNC
+ldx #3
+P0_DELAY:
+dex
+bpl P0_DELAY
+sta RESP0
+ldx #5
+P1_DELAY:
+dex
+bpl P1_DELAY
+sta RESP1
+sta RESM0
+nop
+nop
+sta RESBL
+lda #0x10
+sta HMP0
+lda #0xF0
+sta HMP1
+lda #0x20
+sta HMM0
+lda #0xE0
+sta HMM1
+lda #0x30
+sta HMBL
+
+FRAME:
+lda #0x02
+sta VBLANK
+sta VSYNC
+sta WSYNC
+sta WSYNC
+sta WSYNC
+lda #0x00
+sta VSYNC
+inc FRAME_COUNT
+
+; Move everything
+sta WSYNC
+sta HMOVE
+
+; Reset missile 1 somewhere new every frame
+sta WSYNC
+lda FRAME_COUNT
+and #0x07
+tax
+M1_DELAY:
+dex
+bpl M1_DELAY
+sta RESM1
+
+ldy #34
+VBLANK_LOOP:
+sta WSYNC
+dey
+bne VBLANK_LOOP
+sta WSYNC
+lda #0x00
+sta VBLANK
+
+ldy #192
+PICTURE:
+sta WSYNC
+sty PF1
+sty GRP0
+lda FRAME_COUNT
+sta GRP1
+tya
+sta ENAM0
+lsr
+sta ENAM1
+lsr
+sta ENABL
+cpy #MID_LINE
+bne NOT_MID_LINE
+; Have the players collided yet this frame?
+lda CXPPMM
+bpl NOT_MID_LINE
+inc MID_FRAME_COUNT
+NOT_MID_LINE:
+dey
+bne PICTURE
+
+sta WSYNC
+lda #0x02
+sta VBLANK
+lda #0x00
+sta GRP0
+sta GRP1
+sta ENAM0
+sta ENAM1
+sta ENABL
+
+; Record every collision register, then start over for the next frame
+ldx #7
+RECORD_COLLISIONS:
+lda CXM0P,x
+bpl NO_BIT7
+inc CX_BIT7_COUNT,x
+NO_BIT7:
+asl
+bpl NO_BIT6
+inc CX_BIT6_COUNT,x
+NO_BIT6:
+lda CX_HISTORY,x
+lsr
+lsr
+sta CX_HISTORY,x
+lda CXM0P,x
+and #0xC0
+ora CX_HISTORY,x
+sta CX_HISTORY,x
+dex
+bpl RECORD_COLLISIONS
+sta CXCLR
+
+ldy #28
+OVERSCAN:
+sta WSYNC
+dey
+bne OVERSCAN
+jmp FRAME
+
+*=RESET_VECTOR
+!word ROM_START
@@ -0,0 +1,69 @@
+; Reads both joysticks and player 0's fire button every frame, and folds them
+; into RAM in a way that depends on the order they came in, so input that
+; arrives a frame early or late leaves a different hash. The background shows
+; the joysticks too, so every input changes the frame.
+
+VSYNC = 0x00
+VBLANK = 0x01
+WSYNC = 0x02
+COLUBK = 0x09
+INPT4 = 0x0C
+SWCHA = 0x280
+
+
+ROM_START=0xF000
+RESET_VECTOR=0xFFFC
+
+*=ROM_START
+lda #0
+sta 0x80
+sta 0x81
+sta 0x82
+FRAME:
+lda #0x00
+sta VBLANK
+lda #0x02
+sta VSYNC
+sta WSYNC
+sta WSYNC
+sta WSYNC
+lda #0x00
+sta VSYNC
+; 0x80 is rotated left and mixed with the joysticks, 0x81 sums them, and 0x82
+; counts frames with the button down.
+lda 0x80
+asl
+adc #0
+eor SWCHA
+sta 0x80
+lda 0x81
+clc
+adc SWCHA
+sta 0x81
+lda INPT4
+bmi NO_FIRE
+inc 0x82
+NO_FIRE:
+ldy #37
+VBLANK_LOOP:
+sta WSYNC
+dey
+bne VBLANK_LOOP
+lda SWCHA
+sta COLUBK
+ldy #192
+PICTURE:
+sta WSYNC
+dey
+bne PICTURE
+lda #0x42
+sta VBLANK
+ldy #30
+OVERSCAN:
+sta WSYNC
+dey
+bne OVERSCAN
+jmp FRAME
+
+*=RESET_VECTOR
+!word ROM_START
@@ -0,0 +1,478 @@
+; Writes pseudo-random values to most TIA registers at pseudo-random points on
+; each line, strobes RESxx, HMOVE and CXCLR, and folds the collision registers
+; into RAM. Nothing here is meant to look like anything, it's only there to
+; catch renderer optimizations that change what gets drawn or what collides.
+; The frames are checked against tests/tia_fuzz.frames by "make tia_test".
+
+VSYNC = 0x00
+VBLANK = 0x01
+WSYNC = 0x02
+NUSIZ0 = 0x04
+NUSIZ1 = 0x05
+COLUP0 = 0x06
+COLUP1 = 0x07
+COLUPF = 0x08
+COLUBK = 0x09
+CTRLPF = 0x0A
+REFP0 = 0x0B
+REFP1 = 0x0C
+PF0 = 0x0D
+PF1 = 0x0E
+PF2 = 0x0F
+RESP0 = 0x10
+RESP1 = 0x11
+RESM0 = 0x12
+RESM1 = 0x13
+RESBL = 0x14
+GRP0 = 0x1B
+GRP1 = 0x1C
+ENAM0 = 0x1D
+ENAM1 = 0x1E
+ENABL = 0x1F
+HMP0 = 0x20
+HMP1 = 0x21
+HMM0 = 0x22
+HMM1 = 0x23
+HMBL = 0x24
+VDELP0 = 0x25
+VDELP1 = 0x26
+VDELBL = 0x27
+RESMP0 = 0x28
+RESMP1 = 0x29
+HMOVE = 0x2A
+HMCLR = 0x2B
+CXCLR = 0x2C
+AUDC0 = 0x15
+AUDF0 = 0x17
+AUDV0 = 0x19
+
+ROM_START=0xF000
+RESET_VECTOR=0xFFFC
+
+*=ROM_START
+; Clear RAM
+ldx #0
+lda #0
+CLR:
+sta 0x80,x
+inx
+bpl CLR
+ldx #0
+
+; Each frame starts at a different offset into TBL
+FRAME:
+lda #0x02
+sta VSYNC
+sta WSYNC
+sta WSYNC
+sta WSYNC
+lda #0
+sta VSYNC
+txa
+clc
+adc 0xF7
+tax
+inc 0xF7
+lda #0x02
+sta VBLANK
+ldy #36
+VB:
+sta WSYNC
+lda TBL,x
+sta RESP1
+inx
+lda TBL,x
+sta GRP0
+inx
+dey
+bne VB
+sta WSYNC
+lda #0
+sta VBLANK
+lda #192
+sta 0xFE
+
+; Each line jumps to one of the line kernels below at random
+LINE:
+lda TBL,x
+inx
+and #7
+asl
+tay
+lda JT,y
+sta 0xF8
+lda JT+1,y
+sta 0xF9
+jmp (0xF8)
+
+; Line kernels. Every one writes a few random TIA registers, strobes RESxx at
+; a random point, or adds a collision register into RAM.
+V0:
+sta WSYNC
+lda TBL,x
+sta AUDF0
+inx
+lda TBL,x
+inx
+and #7
+tay
+D0_1:
+dey
+bpl D0_1
+sta RESBL
+lda TBL,x
+sta NUSIZ0
+inx
+lda 0x37
+clc
+adc 0x97
+sta 0x97
+lda TBL,x
+sta REFP0
+inx
+lda TBL,x
+sta VDELP0
+inx
+lda TBL,x
+sta RESMP1
+inx
+lda TBL,x
+sta GRP0
+inx
+lda TBL,x
+inx
+and #7
+tay
+D0_8:
+dey
+bpl D0_8
+sta RESP1
+lda TBL,x
+sta COLUPF
+inx
+dec 0xFE
+bne M0
+jmp OVERSCAN
+M0:
+jmp LINE
+V1:
+lda TBL,x
+sta NUSIZ0
+inx
+lda TBL,x
+inx
+and #7
+tay
+D1_1:
+dey
+bpl D1_1
+sta RESP0
+lda TBL,x
+sta AUDV0
+inx
+lda TBL,x
+inx
+and #7
+tay
+D1_3:
+dey
+bpl D1_3
+sta RESM0
+sta HMOVE
+lda 0x34
+clc
+adc 0x94
+sta 0x94
+lda TBL,x
+sta VDELP1
+inx
+lda 0x36
+clc
+adc 0x96
+sta 0x96
+lda TBL,x
+inx
+and #7
+tay
+D1_8:
+dey
+bpl D1_8
+sta RESM1
+lda TBL,x
+sta RESMP0
+inx
+dec 0xFE
+bne M1
+jmp OVERSCAN
+M1:
+jmp LINE
+V2:
+sta WSYNC
+lda 0x31
+clc
+adc 0x91
+sta 0x91
+lda TBL,x
+sta ENAM1
+inx
+lda TBL,x
+sta AUDV0
+inx
+lda TBL,x
+inx
+and #7
+tay
+D2_3:
+dey
+bpl D2_3
+sta RESM0
+dec 0xFE
+bne M2
+jmp OVERSCAN
+M2:
+jmp LINE
+V3:
+sta WSYNC
+lda TBL,x
+inx
+and #7
+tay
+D3_0:
+dey
+bpl D3_0
+sta RESBL
+lda TBL,x
+inx
+and #7
+tay
+D3_1:
+dey
+bpl D3_1
+sta RESBL
+lda TBL,x
+sta PF1
+inx
+lda TBL,x
+inx
+and #7
+tay
+D3_3:
+dey
+bpl D3_3
+sta RESP0
+lda 0x32
+clc
+adc 0x92
+sta 0x92
+lda TBL,x
+inx
+and #7
+tay
+D3_5:
+dey
+bpl D3_5
+sta RESM0
+nop
+nop
+nop
+lda 0x31
+clc
+adc 0x91
+sta 0x91
+dec 0xFE
+bne M3
+jmp OVERSCAN
+M3:
+jmp LINE
+V4:
+sta WSYNC
+lda TBL,x
+inx
+and #7
+tay
+D4_0:
+dey
+bpl D4_0
+sta RESBL
+lda TBL,x
+sta COLUP1
+inx
+lda TBL,x
+sta HMCLR
+inx
+lda TBL,x
+inx
+and #7
+tay
+D4_3:
+dey
+bpl D4_3
+sta RESM1
+lda TBL,x
+sta RESMP0
+inx
+dec 0xFE
+bne M4
+jmp OVERSCAN
+M4:
+jmp LINE
+V5:
+sta WSYNC
+lda TBL,x
+sta GRP1
+inx
+sta HMOVE
+lda 0x30
+clc
+adc 0x90
+sta 0x90
+lda TBL,x
+inx
+and #7
+tay
+D5_3:
+dey
+bpl D5_3
+sta RESP0
+dec 0xFE
+bne M5
+jmp OVERSCAN
+M5:
+jmp LINE
+V6:
+sta WSYNC
+lda TBL,x
+sta AUDC0
+inx
+lda 0x34
+clc
+adc 0x94
+sta 0x94
+lda TBL,x
+sta NUSIZ1
+inx
+lda TBL,x
+sta COLUP0
+inx
+lda TBL,x
+sta HMP0
+inx
+lda TBL,x
+sta CTRLPF
+inx
+nop
+nop
+nop
+lda TBL,x
+sta REFP1
+inx
+lda TBL,x
+sta NUSIZ1
+inx
+nop
+nop
+nop
+lda TBL,x
+sta PF2
+inx
+dec 0xFE
+bne M6
+jmp OVERSCAN
+M6:
+jmp LINE
+V7:
+lda TBL,x
+sta HMCLR
+inx
+lda TBL,x
+sta HMM1
+inx
+lda 0x31
+clc
+adc 0x91
+sta 0x91
+lda TBL,x
+inx
+and #7
+tay
+D7_3:
+dey
+bpl D7_3
+sta RESBL
+lda TBL,x
+sta HMM1
+inx
+sta HMOVE
+lda TBL,x
+sta PF0
+inx
+lda TBL,x
+sta REFP1
+inx
+dec 0xFE
+bne M7
+jmp OVERSCAN
+M7:
+jmp LINE
+
+; Fold the collisions of the whole frame into RAM too
+OVERSCAN:
+lda #0x02
+sta VBLANK
+lda 0x30
+eor 0xa0
+sta 0xa0
+lda 0x31
+eor 0xa1
+sta 0xa1
+lda 0x32
+eor 0xa2
+sta 0xa2
+lda 0x33
+eor 0xa3
+sta 0xa3
+lda 0x34
+eor 0xa4
+sta 0xa4
+lda 0x35
+eor 0xa5
+sta 0xa5
+lda 0x36
+eor 0xa6
+sta 0xa6
+lda 0x37
+eor 0xa7
+sta 0xa7
+sta CXCLR
+ldy #29
+OS:
+sta WSYNC
+dey
+bne OS
+jmp FRAME
+
+; Line kernel jump table
+JT:
+!word V0,V1,V2,V3,V4,V5,V6,V7
+
+; Random values
+TBL:
+!byte 155,173,5,212,161,10,192,68,30,170,238,180,180,142,250,11
+!byte 31,10,189,128,233,152,163,90,186,94,160,189,135,153,193,53
+!byte 13,67,158,113,137,122,167,95,222,49,52,164,170,114,224,86
+!byte 40,172,111,230,138,115,61,17,97,161,93,142,174,43,176,66
+!byte 215,149,138,237,177,213,148,214,209,18,211,79,102,2,244,222
+!byte 113,16,233,147,174,116,34,146,61,125,23,17,101,220,25,6
+!byte 246,61,87,153,122,10,211,27,58,174,64,129,244,31,180,113
+!byte 101,62,61,87,122,140,65,3,249,204,25,138,127,137,216,26
+!byte 242,165,0,28,64,23,63,25,35,247,16,44,250,161,80,161
+!byte 36,179,197,199,155,184,135,97,168,219,63,65,1,194,40,91
+!byte 21,191,235,194,22,220,27,190,254,161,215,214,235,9,125,111
+!byte 138,36,217,114,218,66,14,166,191,134,62,237,63,192,55,163
+!byte 52,2,242,73,120,199,22,47,50,192,91,12,174,62,13,58
+!byte 246,145,153,45,18,122,54,51,31,166,92,39,123,92,127,232
+!byte 201,129,188,203,179,214,42,192,120,211,82,212,247,79,205,76
+!byte 83,49,254,247,226,95,69,136,101,75,161,118,151,211,136,111
+
+*=RESET_VECTOR
+!word ROM_START
@@ -0,0 +1,57 @@
+; Clears VSYNC a second time a couple of lines after the real end of vertical
+; sync, which some games do. Only the first clear ends a frame, so every mode
+; should draw one frame per pass through FRAME.
+
+VSYNC = 0x00
+VBLANK = 0x01
+WSYNC = 0x02
+COLUBK = 0x09
+
+
+ROM_START=0xF000
+RESET_VECTOR=0xFFFC
+
+*=ROM_START
+lda #0
+sta 0x80
+FRAME:
+lda #0x00
+sta VBLANK
+lda #0x02
+sta VSYNC
+sta WSYNC
+sta WSYNC
+sta WSYNC
+lda #0x00
+sta VSYNC
+sta WSYNC
+sta WSYNC
+; The extra clear
+lda #0x00
+sta VSYNC
+ldy #35
+VBLANK_LOOP:
+sta WSYNC
+dey
+bne VBLANK_LOOP
+; Shift the colors by one every frame so frames can be told apart
+inc 0x80
+ldx 0x80
+ldy #192
+PICTURE:
+inx
+stx COLUBK
+sta WSYNC
+dey
+bne PICTURE
+lda #0x42
+sta VBLANK
+ldy #30
+OVERSCAN:
+sta WSYNC
+dey
+bne OVERSCAN
+jmp FRAME
+
+*=RESET_VECTOR
+!word ROM_START
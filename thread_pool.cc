@@ -0,0 +1,169 @@
+#include "thread_pool.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <set>
+#include <stdio.h>
+#include <utility>
+
+static uint64_t make_range(uint32_t begin, uint32_t end) {
+  return (uint64_t)begin << 32 | end;
+}
+
+// The first hardware thread of each physical core we're allowed to run on,
+// going by sysfs. Empty if we can't tell.
+static std::vector<int> physical_cores() {
+  std::vector<int> cpus;
+
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed))
+    return cpus;
+
+  std::set<std::pair<int, int>> seen;
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    char path[128];
+    int core, package;
+
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+    FILE *file = fopen(path, "r");
+    if (!file)
+      break;
+    bool valid = fscanf(file, "%d", &core) == 1;
+    fclose(file);
+
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%d/topology/physical_package_id",
+             cpu);
+    file = fopen(path, "r");
+    if (!file)
+      break;
+    valid = valid && fscanf(file, "%d", &package) == 1;
+    fclose(file);
+
+    if (valid && CPU_ISSET(cpu, &allowed) &&
+        seen.insert(std::make_pair(package, core)).second)
+      cpus.push_back(cpu);
+  }
+
+  return cpus;
+}
+
+ThreadPool::ThreadPool(int num_threads) {
+  std::vector<int> cpus;
+  if (num_threads <= 0) {
+    cpus = physical_cores();
+    num_threads = cpus.size();
+  }
+  if (num_threads <= 0)
+    num_threads = std::thread::hardware_concurrency();
+  if (num_threads <= 0)
+    num_threads = 1;
+
+  for (int i = 0; i < num_threads; i++) {
+    workers.push_back(std::make_unique<Worker>());
+    if (!cpus.empty())
+      workers.back()->cpu = cpus[i];
+  }
+  for (auto &worker : workers) {
+    worker->thread = std::make_unique<std::thread>(&ThreadPool::run_worker,
+                                                   this, std::ref(*worker));
+    if (worker->cpu >= 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(worker->cpu, &set);
+      pthread_setaffinity_np(worker->thread->native_handle(), sizeof(set),
+                             &set);
+    }
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  work_ready.notify_all();
+  for (auto &worker : workers)
+    worker->thread->join();
+}
+
+bool ThreadPool::pop(Worker &worker, int &index) {
+  uint64_t range = worker.range.load();
+  while (true) {
+    uint32_t begin = range >> 32;
+    uint32_t end = range;
+    if (begin >= end)
+      return false;
+    if (worker.range.compare_exchange_weak(range, make_range(begin + 1, end))) {
+      index = begin;
+      return true;
+    }
+  }
+}
+
+bool ThreadPool::steal(Worker &thief) {
+  for (auto &victim : workers) {
+    if (victim.get() == &thief)
+      continue;
+
+    uint64_t range = victim->range.load();
+    while (true) {
+      uint32_t begin = range >> 32;
+      uint32_t end = range;
+      if (begin >= end)
+        break;
+      uint32_t middle = end - (end - begin + 1) / 2;
+      if (victim->range.compare_exchange_weak(range,
+                                              make_range(begin, middle))) {
+        // Nobody steals from an empty run, so this can't race with anyone.
+        thief.range = make_range(middle, end);
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+void ThreadPool::run_worker(Worker &worker) {
+  uint64_t last_batch = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      work_ready.wait(lock, [&] { return stopping || batch != last_batch; });
+      if (stopping)
+        return;
+      last_batch = batch;
+    }
+
+    int index;
+    do {
+      while (pop(worker, index))
+        (*func)(index);
+    } while (steal(worker));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!--busy)
+      work_done.notify_one();
+  }
+}
+
+void ThreadPool::for_each(int count, const std::function<void(int)> &func) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->func = &func;
+    int num_workers = workers.size();
+    for (int i = 0; i < num_workers; i++)
+      workers[i]->range = make_range((uint64_t)count * i / num_workers,
+                                     (uint64_t)count * (i + 1) / num_workers);
+    batch++;
+    // Every worker has to check in, even if the work is all taken by the time
+    // it wakes up, or it could still be looking for work in the next batch.
+    busy = workers.size();
+  }
+  work_ready.notify_all();
+
+  std::unique_lock<std::mutex> lock(mutex);
+  work_done.wait(lock, [&] { return !busy; });
+}
@@ -0,0 +1,60 @@
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// A fixed set of worker threads for running many consoles at once. Each batch
+// of work is split into a run of indices per worker, so a worker keeps
+// getting the same consoles, and their state stays in its core's caches. A
+// worker that runs out steals half of what another has left, so a console that
+// runs long doesn't hold the others up. Workers only ever touch each other's
+// runs with a compare and swap.
+class ThreadPool {
+  struct Worker {
+    std::unique_ptr<std::thread> thread;
+    // The host CPU the worker is pinned to, or -1.
+    int cpu = -1;
+    // The indices the worker has left in this batch, as begin << 32 | end.
+    std::atomic<uint64_t> range{0};
+  };
+  std::vector<std::unique_ptr<Worker>> workers;
+
+  std::mutex mutex;
+  std::condition_variable work_ready;
+  std::condition_variable work_done;
+
+  // The batch being worked on. Bumping |batch| wakes the workers up for it.
+  const std::function<void(int)> *func = nullptr;
+  uint64_t batch = 0;
+  // Workers that haven't finished the current batch.
+  int busy = 0;
+  bool stopping = false;
+
+  void run_worker(Worker &worker);
+  // Take the next index from the front of |worker|'s run.
+  bool pop(Worker &worker, int &index);
+  // Move the back half of somebody else's run over to |thief|. Returns false
+  // if there was nothing left anywhere.
+  bool steal(Worker &thief);
+
+public:
+  // With |num_threads| set to 0, there's one worker for every physical core,
+  // pinned to it, so no two workers fight over a core's caches.
+  ThreadPool(int num_threads = 0);
+  ~ThreadPool();
+
+  // Calls |func| once for every index below |count|, spread across the pool,
+  // and returns once they've all finished.
+  void for_each(int count, const std::function<void(int)> &func);
+
+  int num_threads() { return workers.size(); }
+};
+
+#endif
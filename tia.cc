@@ -1,14 +1,14 @@
 #include "tia.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "atari.h"
 #include "input.h"
-#include "registers.h"
 #include "sound.h"
-
-using std::placeholders::_1;
-using std::placeholders::_2;
+#include "tia_pipeline.h"
+#include "tia_trace.h"
 
 uint8_t reverse_byte(uint8_t b) {
   b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
@@ -24,169 +24,516 @@ int mod(int a, int b) {
   return ret < 0 ? ret + b : ret;
 }
 
-uint8_t TIA::memory_read_hook(uint16_t addr) {
-  auto read_func = memory_read_table[addr];
+// Register handlers by address. Writes mirror every 0x40 bytes and reads
+// every 0x10. Anything past the last handler is unused.
+const TIA::WriteHandler TIA::write_handlers[0x40] = {
+    &TIA::vsync,  // 0x00
+    &TIA::vblank, // 0x01
+    &TIA::wsync,  // 0x02
+    &TIA::rsync,  // 0x03
+    &TIA::nusiz0, // 0x04
+    &TIA::nusiz1, // 0x05
+    &TIA::colup0, // 0x06
+    &TIA::colup1, // 0x07
+    &TIA::colupf, // 0x08
+    &TIA::colubk, // 0x09
+    &TIA::ctrlpf, // 0x0A
+    &TIA::refp0,  // 0x0B
+    &TIA::refp1,  // 0x0C
+    &TIA::pf0,    // 0x0D
+    &TIA::pf1,    // 0x0E
+    &TIA::pf2,    // 0x0F
+    &TIA::resp0,  // 0x10
+    &TIA::resp1,  // 0x11
+    &TIA::resm0,  // 0x12
+    &TIA::resm1,  // 0x13
+    &TIA::resbl,  // 0x14
+    &TIA::audc0,  // 0x15
+    &TIA::audc1,  // 0x16
+    &TIA::audf0,  // 0x17
+    &TIA::audf1,  // 0x18
+    &TIA::audv0,  // 0x19
+    &TIA::audv1,  // 0x1A
+    &TIA::grp0,   // 0x1B
+    &TIA::grp1,   // 0x1C
+    &TIA::enam0,  // 0x1D
+    &TIA::enam1,  // 0x1E
+    &TIA::enabl,  // 0x1F
+    &TIA::hmp0,   // 0x20
+    &TIA::hmp1,   // 0x21
+    &TIA::hmm0,   // 0x22
+    &TIA::hmm1,   // 0x23
+    &TIA::hmbl,   // 0x24
+    &TIA::vdelp0, // 0x25
+    &TIA::vdelp1, // 0x26
+    &TIA::vdelbl, // 0x27
+    &TIA::resmp0, // 0x28
+    &TIA::resmp1, // 0x29
+    &TIA::hmove,  // 0x2A
+    &TIA::hmclr,  // 0x2B
+    &TIA::cxclr,  // 0x2C
+};
+
+const TIA::ReadHandler TIA::read_handlers[0x10] = {
+    &TIA::cxm0p,  // 0x00
+    &TIA::cxm1p,  // 0x01
+    &TIA::cxp0fb, // 0x02
+    &TIA::cxp1fb, // 0x03
+    &TIA::cxm0fb, // 0x04
+    &TIA::cxm1fb, // 0x05
+    &TIA::cxblpf, // 0x06
+    &TIA::cxppmm, // 0x07
+    &TIA::inpt0,  // 0x08
+    &TIA::inpt1,  // 0x09
+    &TIA::inpt2,  // 0x0A
+    &TIA::inpt3,  // 0x0B
+    &TIA::inpt4,  // 0x0C
+    &TIA::inpt5,  // 0x0D
+};
+
+bool TIA::memory_read_hook(uint16_t addr, uint8_t &val) {
+  // The collision registers need to see every pixel drawn so far.
+  if ((addr & 0x0F) < 0x08) {
+    flush();
+    resolve_collisions();
+  }
+
+  ReadHandler read_func = read_handlers[addr & 0x0F];
   if (!read_func) {
-    printf("Warning! Invalid TIA read at %x. PC: %x\n", addr, program_counter);
-    return 0;
+    val = 0;
+    return false;
   }
 
-  return read_func();
+  val = (this->*read_func)();
+  return true;
 }
 
-void TIA::memory_write_hook(uint16_t addr, uint8_t val) {
-  auto write_func = memory_write_table[addr];
-  if (!write_func) {
-    printf("Warning! Invalid TIA write at %x. PC: %x\n", addr, program_counter);
-    return;
-  }
+bool TIA::memory_write_hook(uint16_t addr, uint8_t val) {
+  if (!write_handlers[addr & 0x3F])
+    return false;
 
-  memory_write_request = write_func;
-  memory_val = val;
+  pending_write = {true, (uint8_t)addr, val};
+  return true;
 }
 
-bool TIA::can_draw_playfield(int visible_x) {
-  return visible_x >= 0 && ((playfield_mask >> (visible_x / 4)) & 0x01);
+// Sprite graphics blown up by each player scale, indexed by log2(scale) and
+// the (already reflected) graphics byte. Each bit is one pixel.
+struct ScaledGraphics {
+  uint32_t pixels[3][256];
+};
+
+constexpr ScaledGraphics make_scaled_graphics() {
+  ScaledGraphics table = {};
+  for (int scale_shift = 0; scale_shift < 3; scale_shift++) {
+    for (int graphics = 0; graphics < 256; graphics++) {
+      uint32_t pixels = 0;
+      for (int i = 0; i < TIA::player_size << scale_shift; i++)
+        pixels |= (uint32_t)((graphics >> (i >> scale_shift)) & 0x01) << i;
+      table.pixels[scale_shift][graphics] = pixels;
+    }
+  }
+  return table;
 }
 
-void TIA::draw_playfield(int visible_x) {
-  if (!playfield_score_mode) {
-    ntsc->write_pixel(playfield_color);
-  } else {
-    if (visible_x < NTSC::visible_columns / 2) {
-      ntsc->write_pixel(player0_color);
-    } else {
-      ntsc->write_pixel(player1_color);
+constexpr ScaledGraphics scaled_graphics = make_scaled_graphics();
+
+// Each playfield bit covers 4 pixels. Indexed by 4 playfield bits at a time.
+struct PlayfieldPixels {
+  uint16_t pixels[16];
+};
+
+constexpr PlayfieldPixels make_playfield_pixels() {
+  PlayfieldPixels table = {};
+  for (int bits = 0; bits < 16; bits++) {
+    for (int i = 0; i < 4; i++) {
+      if ((bits >> i) & 0x01)
+        table.pixels[bits] |= 0xF << (4 * i);
     }
   }
+  return table;
 }
 
-bool TIA::can_draw_ball(int visible_x) {
-  return ball_enable &&
-         mod(visible_x - ball_x, NTSC::visible_columns) < ball_size;
-}
+constexpr PlayfieldPixels playfield_pixels = make_playfield_pixels();
 
-void TIA::draw_ball() { ntsc->write_pixel(playfield_color); }
+void TIA::build_player_line(LineMask &line, int player_x, uint8_t player_mask,
+                            int duplicate_mask, int scale) {
+  line.clear();
 
-bool TIA::can_draw_player(int visible_x, int player_x, uint8_t player_mask,
-                          int duplicate_mask, int scale) {
   if (!duplicate_mask) {
-    return mod(visible_x - player_x, NTSC::visible_columns) <
-               player_size * scale &&
-           ((player_mask >>
-             (mod(visible_x - player_x, NTSC::visible_columns) / scale)) &
-            0x01);
+    int scale_shift = __builtin_ctz(scale);
+    line.insert(mod(player_x, NTSC::visible_columns),
+                scaled_graphics.pixels[scale_shift][player_mask],
+                player_size * scale);
   } else {
-    return ((duplicate_mask >>
-             (mod(visible_x - player_x, NTSC::visible_columns) / player_size)) &
-            0x01) &&
-           ((player_mask >>
-             (mod(visible_x - player_x, NTSC::visible_columns) % player_size)) &
-            0x01);
+    for (int copy = 0; duplicate_mask >> copy; copy++) {
+      if ((duplicate_mask >> copy) & 0x01)
+        line.insert(mod(player_x + copy * player_size, NTSC::visible_columns),
+                    player_mask, player_size);
+    }
   }
 }
 
-void TIA::draw_player(uint8_t player_color) { ntsc->write_pixel(player_color); }
-
-bool TIA::can_draw_missile(int visible_x, int missile_x, int missile_size,
-                           bool missile_enabled, int duplicate_mask) {
+void TIA::build_missile_line(LineMask &line, int missile_x, int missile_size,
+                             bool missile_enabled, int duplicate_mask) {
+  line.clear();
   if (!missile_enabled)
-    return false;
+    return;
 
   if (!duplicate_mask) {
-    return mod(visible_x - missile_x, NTSC::visible_columns) < missile_size;
+    line.insert(mod(missile_x, NTSC::visible_columns),
+                (1ull << missile_size) - 1, missile_size);
   } else {
-    return ((duplicate_mask >>
-             mod(visible_x - missile_x, NTSC::visible_columns) / player_size) &
-            0x01) &&
-           (mod(visible_x - missile_x, NTSC::visible_columns) % player_size) <
-               missile_size;
+    // Missiles are copied along with their player, but never spill over into
+    // the next copy.
+    int size = missile_size < player_size ? missile_size : player_size;
+    for (int copy = 0; duplicate_mask >> copy; copy++) {
+      if ((duplicate_mask >> copy) & 0x01)
+        line.insert(mod(missile_x + copy * player_size, NTSC::visible_columns),
+                    (1ull << size) - 1, size);
+    }
   }
 }
 
-void TIA::draw_missile(uint8_t missile_color) {
-  ntsc->write_pixel(missile_color);
+void TIA::build_lines() {
+  if (!lines.drawn.empty()) {
+    if (num_pending_lines == max_pending_lines)
+      resolve_collisions();
+    pending_lines[num_pending_lines++] = lines;
+    lines.drawn.clear();
+    lines.playfield_drawn.clear();
+  }
+
+  if (dirty_lines & player0_bit)
+    build_player_line(lines.player0, state.player0_x, state.player0_mask,
+                      state.player0_duplicate_mask, state.player0_scale);
+  if (dirty_lines & player1_bit)
+    build_player_line(lines.player1, state.player1_x, state.player1_mask,
+                      state.player1_duplicate_mask, state.player1_scale);
+  if (dirty_lines & missile0_bit)
+    build_missile_line(lines.missile0, state.missile0_x, state.missile0_size,
+                       state.missile0_enable, state.player0_duplicate_mask);
+  if (dirty_lines & missile1_bit)
+    build_missile_line(lines.missile1, state.missile1_x, state.missile1_size,
+                       state.missile1_enable, state.player1_duplicate_mask);
+
+  if (dirty_lines & ball_bit) {
+    lines.ball.clear();
+    if (state.ball_enable)
+      lines.ball.insert(mod(state.ball_x, NTSC::visible_columns),
+                       (1ull << state.ball_size) - 1, state.ball_size);
+  }
+
+  if (dirty_lines & playfield_bit) {
+    lines.playfield.clear();
+    for (int i = 0; i < NTSC::visible_columns / 16; i++) {
+      int bits = (state.playfield_mask >> (4 * i)) & 0x0F;
+      lines.playfield.insert(16 * i, playfield_pixels.pixels[bits], 16);
+    }
+  }
+
+  dirty_lines = 0;
+}
+
+// Set every pixel marked in |mask| to |color|.
+static inline void paint(uint8_t *pixels, uint64_t mask, uint8_t color) {
+  while (mask) {
+    pixels[__builtin_ctzll(mask)] = color;
+    mask &= mask - 1;
+  }
+}
+
+void TIA::composite(uint8_t *pixels, int pos, int count,
+                    bool playfield_visible) {
+  uint64_t player0 = lines.player0.extract(pos, count);
+  uint64_t player1 = lines.player1.extract(pos, count);
+  uint64_t missile0 = lines.missile0.extract(pos, count);
+  uint64_t missile1 = lines.missile1.extract(pos, count);
+  uint64_t ball = lines.ball.extract(pos, count);
+  uint64_t playfield =
+      playfield_visible ? lines.playfield.extract(pos, count) : 0;
+
+  // Pick something to draw based on priority logic. Each object only keeps
+  // the pixels nothing in front of it covers.
+  uint64_t sprites0 = player0 | missile0;
+  uint64_t sprites1 = player1 | missile1;
+  if (state.playfield_priority) {
+    ball &= ~playfield;
+    sprites0 &= ~(playfield | ball);
+    sprites1 &= ~(playfield | ball | sprites0);
+  } else {
+    sprites1 &= ~sprites0;
+    playfield &= ~(sprites0 | sprites1);
+    ball &= ~(sprites0 | sprites1 | playfield);
+  }
+
+  memset(pixels, state.background_color, count);
+  if (!state.playfield_score_mode) {
+    paint(pixels, playfield, state.playfield_color);
+  } else {
+    // Score mode colors the left half of the playfield with player 0's color
+    // and the right half with player 1's.
+    int left_count = NTSC::visible_columns / 2 - pos;
+    uint64_t left = left_count <= 0       ? 0
+                    : left_count >= count ? ~0ull
+                                          : (1ull << left_count) - 1;
+    paint(pixels, playfield & left, state.player0_color);
+    paint(pixels, playfield & ~left, state.player1_color);
+  }
+  paint(pixels, ball, state.playfield_color);
+  paint(pixels, sprites0, state.player0_color);
+  paint(pixels, sprites1, state.player1_color);
+}
+
+void TIA::latch_collisions(const ObjectLines &drawn_lines) {
+  for (int i = 0; i < 3; i++) {
+    uint64_t drawn = drawn_lines.drawn.bits[i];
+    uint64_t player0 = drawn_lines.player0.bits[i] & drawn;
+    uint64_t player1 = drawn_lines.player1.bits[i] & drawn;
+    uint64_t missile0 = drawn_lines.missile0.bits[i] & drawn;
+    uint64_t missile1 = drawn_lines.missile1.bits[i] & drawn;
+    uint64_t ball = drawn_lines.ball.bits[i] & drawn;
+    uint64_t playfield =
+        drawn_lines.playfield.bits[i] & drawn_lines.playfield_drawn.bits[i];
+
+    if (missile0 & player1)
+      regs.collisions |= missile0_player1;
+    if (missile0 & player0)
+      regs.collisions |= missile0_player0;
+    if (missile1 & player0)
+      regs.collisions |= missile1_player0;
+    if (missile1 & player1)
+      regs.collisions |= missile1_player1;
+    if (player0 & playfield)
+      regs.collisions |= player0_playfield;
+    if (player0 & ball)
+      regs.collisions |= player0_ball;
+    if (player1 & playfield)
+      regs.collisions |= player1_playfield;
+    if (player1 & ball)
+      regs.collisions |= player1_ball;
+    if (missile0 & playfield)
+      regs.collisions |= missile0_playfield;
+    if (missile0 & ball)
+      regs.collisions |= missile0_ball;
+    if (missile1 & playfield)
+      regs.collisions |= missile1_playfield;
+    if (missile1 & ball)
+      regs.collisions |= missile1_ball;
+    if (ball & playfield)
+      regs.collisions |= ball_playfield;
+    if (player0 & player1)
+      regs.collisions |= player0_player1;
+    if (missile0 & missile1)
+      regs.collisions |= missile0_missile1;
+  }
 }
 
-void TIA::process_tia_cycle() {
-  if (!vblank_mode) {
+void TIA::resolve_collisions() {
+  for (int i = 0; i < num_pending_lines; i++)
+    latch_collisions(pending_lines[i]);
+  num_pending_lines = 0;
+
+  latch_collisions(lines);
+  lines.drawn.clear();
+  lines.playfield_drawn.clear();
+}
+
+void TIA::render_scanline_span(int count) {
+  if (!count)
+    return;
+
+  // RSYNC can put the gun a few pixels before the start of the scanline.
+  uint8_t pixels[NTSC::columns + tia_cycle_ratio];
+
+  if (state.vblank_mode) {
+    if (draw_pixels)
+      memset(pixels, 0, count);
+  } else {
+    if (dirty_lines)
+      build_lines();
+
+    // Sprites are still evaluated during the horizontal blank, wrapping
+    // around from the right side of the line, so collisions can happen there.
+    // The end of the line lines up with the end of the blank, so no chunk
+    // is ever partly blanked.
     int visible_x = ntsc->gun_x - NTSC::hblank;
+    for (int i = 0; i < count;) {
+      int pos = mod(visible_x, NTSC::visible_columns);
+      int chunk = count - i;
+      if (chunk > 64)
+        chunk = 64;
+      if (chunk > NTSC::visible_columns - pos)
+        chunk = NTSC::visible_columns - pos;
+
+      if (track_collisions) {
+        uint64_t drawn = chunk < 64 ? (1ull << chunk) - 1 : ~0ull;
+        lines.drawn.insert(pos, drawn, chunk);
+        if (visible_x >= 0)
+          lines.playfield_drawn.insert(pos, drawn, chunk);
+      }
+
+      if (draw_pixels)
+        composite(&pixels[i], pos, chunk, visible_x >= 0);
+
+      i += chunk;
+      visible_x += chunk;
+    }
+  }
 
-    // What objects occupy the current pixel.
-    bool player0 = can_draw_player(visible_x, player0_x, player0_mask,
-                                   player0_duplicate_mask, player0_scale);
-    bool player1 = can_draw_player(visible_x, player1_x, player1_mask,
-                                   player1_duplicate_mask, player1_scale);
-    bool missile0 = can_draw_missile(visible_x, missile0_x, missile0_size,
-                                     missile0_enable, player0_duplicate_mask);
-    bool missile1 = can_draw_missile(visible_x, missile1_x, missile1_size,
-                                     missile1_enable, player1_duplicate_mask);
-    bool ball = can_draw_ball(visible_x);
-    bool playfield = can_draw_playfield(visible_x);
-
-    // Update collision registers
-    missile0_player1 |= missile0 && player1;
-    missile0_player0 |= missile0 && player0;
-    missile1_player0 |= missile1 && player0;
-    missile1_player1 |= missile1 && player1;
-    player0_playfield |= player0 && playfield;
-    player0_ball |= player0 && ball;
-    player1_playfield |= player1 && playfield;
-    player1_ball |= player1 && ball;
-    missile0_playfield |= missile0 && playfield;
-    missile0_ball |= missile0 && ball;
-    missile1_playfield |= missile1 && playfield;
-    missile1_ball |= missile1 && ball;
-    ball_playfield |= ball && playfield;
-    player0_player1 |= player0 && player1;
-    missile0_missile1 |= missile0 && missile1;
-
-    // Pick something to draw based on priority logic
-    if (playfield_priority && playfield) {
-      draw_playfield(visible_x);
-    } else if (playfield_priority && ball) {
-      draw_ball();
-    } else if (player0) {
-      draw_missile(player0_color);
-    } else if (missile0) {
-      draw_player(player0_color);
-    } else if (player1) {
-      draw_player(player1_color);
-    } else if (missile1) {
-      draw_missile(player1_color);
-    } else if (!playfield_priority && playfield) {
-      draw_playfield(visible_x);
-    } else if (!playfield_priority && ball) {
-      draw_ball();
+  if (draw_pixels) {
+    // Hang on to the visible pixels in case this scanline goes in the cache.
+    int x = ntsc->gun_x - NTSC::hblank;
+    int start = x < 0 ? 0 : x;
+    int end = x + count > NTSC::visible_columns ? NTSC::visible_columns
+                                                : x + count;
+    if (start < end)
+      memcpy(&line_pixels[start], &pixels[start - x], end - start);
+  }
+
+  ntsc->write_span(pixels, count);
+  regs.tia_cycle_num += count;
+}
+
+void TIA::render(uint64_t tia_cycles) {
+  while (tia_cycles) {
+    if (!deferring_line)
+      start_line();
+
+    if (deferring_line) {
+      uint64_t count = NTSC::columns - line_cycles;
+      if (count > tia_cycles)
+        count = tia_cycles;
+      line_cycles += count;
+      regs.tia_cycle_num += count;
+      tia_cycles -= count;
+
+      if (line_cycles == NTSC::columns)
+        finish_line();
     } else {
-      ntsc->write_pixel(background_color);
+      uint64_t count = NTSC::columns - ntsc->gun_x;
+      if (count > tia_cycles)
+        count = tia_cycles;
+      render_scanline_span(count);
+      tia_cycles -= count;
     }
-  } else {
-    ntsc->write_pixel();
   }
-  tia_cycle_num++;
+}
+
+void TIA::start_line() {
+  // There's nothing to gain from the cache if we aren't drawing.
+  if (!draw_pixels || ntsc->gun_x)
+    return;
+
+  deferring_line = true;
+  line_start_tia_cycle = regs.tia_cycle_num;
+  line_cycles = 0;
+  num_line_writes = 0;
+}
+
+void TIA::replay_line(int cycles) {
+  regs.tia_cycle_num = line_start_tia_cycle;
+
+  int drawn = 0;
+  for (int i = 0; i < num_line_writes; i++) {
+    const QueuedWrite &write = line_writes[i];
+    render_scanline_span(write.cycle - drawn);
+    drawn = write.cycle;
+    (this->*write_handlers[write.addr])(write.val);
+  }
+  render_scanline_span(cycles - drawn);
+}
+
+uint64_t TIA::hash_line() {
+  // FNV-1a
+  uint64_t hash = 0xcbf29ce484222325;
+  auto hash_bytes = [&hash](const void *data, size_t len) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) {
+      hash ^= bytes[i];
+      hash *= 0x100000001b3;
+    }
+  };
+
+  int phase = mod(line_start_tia_cycle, NTSC::columns);
+  hash_bytes(&state, sizeof(state));
+  hash_bytes(&phase, sizeof(phase));
+  hash_bytes(line_writes, num_line_writes * sizeof(QueuedWrite));
+  return hash;
+}
+
+bool TIA::line_matches(const CachedLine &line) {
+  return line.valid && line.phase == mod(line_start_tia_cycle, NTSC::columns) &&
+         line.num_writes == num_line_writes &&
+         !memcmp(&line.state, &state, sizeof(state)) &&
+         !memcmp(line.writes, line_writes,
+                 num_line_writes * sizeof(QueuedWrite));
+}
+
+void TIA::finish_line() {
+  deferring_line = false;
+  CachedLine &line = line_cache[hash_line() % line_cache_size];
+
+  if (line_matches(line)) {
+    // We still have to apply the writes to get to the state the scanline
+    // ended with, just without drawing anything.
+    for (int i = 0; i < num_line_writes; i++) {
+      regs.tia_cycle_num = line_start_tia_cycle + line_writes[i].cycle;
+      (this->*write_handlers[line_writes[i].addr])(line_writes[i].val);
+    }
+    regs.tia_cycle_num = line_start_tia_cycle + NTSC::columns;
+
+    ntsc->write_line(line.pixels);
+    regs.collisions |= line.collisions;
+    line_cache_hits++;
+    return;
+  }
+
+  line.valid = true;
+  line.state = state;
+  line.phase = mod(line_start_tia_cycle, NTSC::columns);
+  line.num_writes = num_line_writes;
+  memcpy(line.writes, line_writes, num_line_writes * sizeof(QueuedWrite));
+
+  // Work out the collisions from just this scanline.
+  resolve_collisions();
+  uint16_t prev_collisions = regs.collisions;
+  regs.collisions = 0;
+
+  replay_line(NTSC::columns);
+
+  resolve_collisions();
+  line.collisions = regs.collisions;
+  regs.collisions |= prev_collisions;
+  memcpy(line.pixels, line_pixels, NTSC::visible_columns);
+  line_cache_misses++;
+}
+
+void TIA::abandon_line() {
+  deferring_line = false;
+  replay_line(line_cycles);
+  lines_uncached++;
 }
 
 void TIA::handle_playfield_mirror() {
-  playfield_mask = playfield_mask & 0xFFFFF;
-  if (!playfield_mirrored) {
-    playfield_mask |= playfield_mask | playfield_mask << 20;
+  state.playfield_mask = state.playfield_mask & 0xFFFFF;
+  if (!state.playfield_mirrored) {
+    state.playfield_mask |= state.playfield_mask | state.playfield_mask << 20;
   } else {
-    uint64_t pf0 = playfield_mask & 0x0F;
-    uint64_t pf1 = (playfield_mask >> 4) & 0xFF;
-    uint64_t pf2 = (playfield_mask >> 12) & 0xFF;
+    uint64_t pf0 = state.playfield_mask & 0x0F;
+    uint64_t pf1 = (state.playfield_mask >> 4) & 0xFF;
+    uint64_t pf2 = (state.playfield_mask >> 12) & 0xFF;
     pf0 = reverse_byte(pf0) >> 4;
     pf1 = reverse_byte(pf1);
     pf2 = reverse_byte(pf2);
-    playfield_mask |= playfield_mask;
-    playfield_mask |= pf2 << 20;
-    playfield_mask |= pf1 << 28;
-    playfield_mask |= pf0 << 36;
+    state.playfield_mask |= state.playfield_mask;
+    state.playfield_mask |= pf2 << 20;
+    state.playfield_mask |= pf1 << 28;
+    state.playfield_mask |= pf0 << 36;
   }
 }
 
 void TIA::reset_sprite_position(int &sprite, int hblank_fudge, int fudge) {
-  sprite = (tia_cycle_num % NTSC::columns) - NTSC::hblank;
+  sprite = (regs.tia_cycle_num % NTSC::columns) - NTSC::hblank;
   if (sprite < 0) {
     sprite = hblank_fudge;
   } else {
@@ -197,32 +544,40 @@ void TIA::reset_sprite_position(int &sprite, int hblank_fudge, int fudge) {
 // Bit 1 is the only active bit.
 // Vertical sync occurs when we set the VSYNC for 3 scanlines and then clear it.
 void TIA::vsync(uint8_t val) {
-  bool new_vsync_mode = val & 0x02;
-  if (vsync_mode && !new_vsync_mode)
+  bool ending_vsync = regs.vsync_mode && !(val & 0x02);
+
+  // The next frame's log starts from our state after this write, otherwise the
+  // render thread would see any later VSYNC clear as the end of another frame.
+  regs.vsync_mode = val & 0x02;
+
+  if (ending_vsync) {
     ntsc->vsync();
-  vsync_mode = new_vsync_mode;
+    if (pipeline)
+      pipeline->end_frame(drawing_frame);
+    start_frame();
+  }
 }
 
 // Bit 1 is the only active bit.
 // Blanks the screen before and after the visible draw area.
 void TIA::vblank(uint8_t val) {
   // TODO: Add input control support
-  vblank_mode = val == 0x02;
+  state.vblank_mode = val == 0x02;
 }
 
 // Resets the electron gun to the far left of the screen, no matter what the
 // current clock cycle is. Scanline will be unchanged.
 void TIA::rsync(uint8_t val) {
-  tia_cycle_num = -3;
+  regs.tia_cycle_num = -3;
   ntsc->gun_x = -3;
 }
 
 // Sleep the CPU until we finish the scanline. Scanline number will increment,
 // and we will output the rest of the pixels on the current line.
 void TIA::wsync(uint8_t val) {
-  if (tia_cycle_num % NTSC::columns)
-    cycle_num +=
-        (NTSC::columns - (tia_cycle_num % NTSC::columns)) / tia_cycle_ratio;
+  if (regs.tia_cycle_num % NTSC::columns)
+    cycle_num += (NTSC::columns - (regs.tia_cycle_num % NTSC::columns)) /
+                 tia_cycle_ratio;
 }
 
 // NUSIZ registers have complicated behavior.
@@ -278,30 +633,34 @@ void TIA::handle_nusiz(uint8_t val, int &dup_mask, int &scale,
     break;
   default:
     printf("Invalid player setting\n");
-    panic();
+    exit(-1);
     break;
   }
 }
 
 void TIA::nusiz0(uint8_t val) {
-  handle_nusiz(val, player0_duplicate_mask, player0_scale, missile0_size);
+  handle_nusiz(val, state.player0_duplicate_mask, state.player0_scale,
+               state.missile0_size);
+  dirty_lines |= player0_bit | missile0_bit;
 }
 
 void TIA::nusiz1(uint8_t val) {
-  handle_nusiz(val, player1_duplicate_mask, player1_scale, missile1_size);
+  handle_nusiz(val, state.player1_duplicate_mask, state.player1_scale,
+               state.missile1_size);
+  dirty_lines |= player1_bit | missile1_bit;
 }
 
 // Set player 0 (and missile 0) color
-void TIA::colup0(uint8_t val) { player0_color = val; }
+void TIA::colup0(uint8_t val) { state.player0_color = val; }
 
 // Set player 1 (and missile 1) color
-void TIA::colup1(uint8_t val) { player1_color = val; }
+void TIA::colup1(uint8_t val) { state.player1_color = val; }
 
 // Set playfield (and ball) color
-void TIA::colupf(uint8_t val) { playfield_color = val; }
+void TIA::colupf(uint8_t val) { state.playfield_color = val; }
 
 // Set background color
-void TIA::colubk(uint8_t val) { background_color = val; }
+void TIA::colubk(uint8_t val) { state.background_color = val; }
 
 // Playfield control
 // Bit 0 controls mirroring
@@ -310,29 +669,32 @@ void TIA::colubk(uint8_t val) { background_color = val; }
 // right half. Bit 2 controls the priority. If true, the playfield will be drawn
 // over the players, rather than the other way around.
 void TIA::ctrlpf(uint8_t val) {
-  playfield_mirrored = val & 0x01;
-  playfield_score_mode = val & 0x02;
-  playfield_priority = val & 0x04;
+  state.playfield_mirrored = val & 0x01;
+  state.playfield_score_mode = val & 0x02;
+  state.playfield_priority = val & 0x04;
 
   handle_playfield_mirror();
 
-  ball_size = 1 << ((val >> 4) & 0x03);
+  state.ball_size = 1 << ((val >> 4) & 0x03);
+  dirty_lines |= playfield_bit | ball_bit;
 }
 
 // Only bit 2 is used.
 // Controls the reflection of the player sprite.
 void TIA::refp0(uint8_t val) {
   bool new_p0_reflect = val & 0x8;
-  if (new_p0_reflect != player0_reflect)
-    player0_mask = reverse_byte(player0_mask);
-  player0_reflect = new_p0_reflect;
+  if (new_p0_reflect != state.player0_reflect)
+    state.player0_mask = reverse_byte(state.player0_mask);
+  state.player0_reflect = new_p0_reflect;
+  dirty_lines |= player0_bit;
 }
 
 void TIA::refp1(uint8_t val) {
   bool new_p1_reflect = val & 0x8;
-  if (new_p1_reflect != player1_reflect)
-    player1_mask = reverse_byte(player1_mask);
-  player1_reflect = new_p1_reflect;
+  if (new_p1_reflect != state.player1_reflect)
+    state.player1_mask = reverse_byte(state.player1_mask);
+  state.player1_reflect = new_p1_reflect;
+  dirty_lines |= player1_bit;
 }
 
 // Playfield registers. Note that the playfield is either repeated or mirrored,
@@ -342,129 +704,154 @@ void TIA::refp1(uint8_t val) {
 // Sets the first 16 pixels of the playfield. 1 bit = 4 pixels. Upper 4 bits
 // ignored.
 void TIA::pf0(uint8_t val) {
-  playfield_mask &= ~0x0F;
-  playfield_mask |= val >> 4;
+  state.playfield_mask &= ~0x0F;
+  state.playfield_mask |= val >> 4;
   handle_playfield_mirror();
+  dirty_lines |= playfield_bit;
 }
 
 // Sets pixels 16-48 of the playfield. 1 bit = 4 pixels. This register is
 // reversed from the other two.
 void TIA::pf1(uint8_t val) {
   val = reverse_byte(val);
-  playfield_mask &= ~0xFF0;
-  playfield_mask |= ((uint64_t)val) << 4;
+  state.playfield_mask &= ~0xFF0;
+  state.playfield_mask |= ((uint64_t)val) << 4;
   handle_playfield_mirror();
+  dirty_lines |= playfield_bit;
 }
 
 // Sets pixels 48-80 of the playfield. 1 bit = 4 pixels.
 void TIA::pf2(uint8_t val) {
-  playfield_mask &= ~0xFF000;
-  playfield_mask |= ((uint64_t)val) << 12;
+  state.playfield_mask &= ~0xFF000;
+  state.playfield_mask |= ((uint64_t)val) << 12;
   handle_playfield_mirror();
+  dirty_lines |= playfield_bit;
 }
 
 // Reset player position to current pixel
 void TIA::resp0(uint8_t val) {
-  reset_sprite_position(player0_x, 3, resp_player_offset);
+  reset_sprite_position(state.player0_x, 3, resp_player_offset);
+  dirty_lines |= player0_bit;
 }
 
 void TIA::resp1(uint8_t val) {
-  reset_sprite_position(player1_x, 3, resp_player_offset);
+  reset_sprite_position(state.player1_x, 3, resp_player_offset);
+  dirty_lines |= player1_bit;
 }
 
 // Reset missile position to current pixel
 void TIA::resm0(uint8_t val) {
-  reset_sprite_position(missile0_x, 2, resp_missile_ball_offset);
+  reset_sprite_position(state.missile0_x, 2, resp_missile_ball_offset);
+  dirty_lines |= missile0_bit;
 }
 
 void TIA::resm1(uint8_t val) {
-  reset_sprite_position(missile1_x, 2, resp_missile_ball_offset);
+  reset_sprite_position(state.missile1_x, 2, resp_missile_ball_offset);
+  dirty_lines |= missile1_bit;
 }
 
 // Reset ball position to current pixel
 void TIA::resbl(uint8_t val) {
-  reset_sprite_position(ball_x, 2, resp_missile_ball_offset);
+  reset_sprite_position(state.ball_x, 2, resp_missile_ball_offset);
+  dirty_lines |= ball_bit;
 }
 
 // Set player sprite. 1 bit = 1 pixel
 void TIA::grp0(uint8_t val) {
-  if (!player0_reflect) {
+  if (!state.player0_reflect) {
     val = reverse_byte(val);
   }
 
-  if (!player0_mask_delay) {
-    player0_mask = val;
+  if (!state.player0_mask_delay) {
+    state.player0_mask = val;
   } else {
-    player0_mask_buf = val;
+    state.player0_mask_buf = val;
   }
 
-  if (player1_mask_delay)
-    player1_mask = player1_mask_buf;
+  if (state.player1_mask_delay)
+    state.player1_mask = state.player1_mask_buf;
+
+  dirty_lines |= player0_bit | player1_bit;
 }
 
 void TIA::grp1(uint8_t val) {
-  if (!player1_reflect) {
+  if (!state.player1_reflect) {
     val = reverse_byte(val);
   }
 
-  if (!player1_mask_delay) {
-    player1_mask = val;
+  if (!state.player1_mask_delay) {
+    state.player1_mask = val;
   } else {
-    player1_mask_buf = val;
+    state.player1_mask_buf = val;
   }
 
-  if (player0_mask_delay)
-    player0_mask = player0_mask_buf;
+  if (state.player0_mask_delay)
+    state.player0_mask = state.player0_mask_buf;
 
-  if (ball_enable_delay)
-    ball_enable = ball_enable_buf;
+  if (state.ball_enable_delay)
+    state.ball_enable = state.ball_enable_buf;
+
+  dirty_lines |= player0_bit | player1_bit | ball_bit;
 }
 
 // Set missiles enabled. Only bit 1 is used.
-void TIA::enam0(uint8_t val) { missile0_enable = val & 0x02; }
+void TIA::enam0(uint8_t val) {
+  state.missile0_enable = val & 0x02;
+  dirty_lines |= missile0_bit;
+}
 
-void TIA::enam1(uint8_t val) { missile1_enable = val & 0x02; }
+void TIA::enam1(uint8_t val) {
+  state.missile1_enable = val & 0x02;
+  dirty_lines |= missile1_bit;
+}
 
 // Set ball enabled. Only bit 1 is used.
 void TIA::enabl(uint8_t val) {
-  if (!ball_enable_delay) {
-    ball_enable = val & 0x02;
+  if (!state.ball_enable_delay) {
+    state.ball_enable = val & 0x02;
   } else {
-    ball_enable_buf = val & 0x02;
+    state.ball_enable_buf = val & 0x02;
   }
+  dirty_lines |= ball_bit;
 }
 
 // Set player "motion".
 // Upper 4 bits represent a signed 4 bit value.
-void TIA::hmp0(uint8_t val) { player0_motion = -(((int8_t)(val & 0xF0)) / 16); }
+void TIA::hmp0(uint8_t val) {
+  state.player0_motion = -(((int8_t)(val & 0xF0)) / 16);
+}
 
-void TIA::hmp1(uint8_t val) { player1_motion = -(((int8_t)(val & 0xF0)) / 16); }
+void TIA::hmp1(uint8_t val) {
+  state.player1_motion = -(((int8_t)(val & 0xF0)) / 16);
+}
 
 // Set missile "motion".
 // Upper 4 bits represent a signed 4 bit value.
 void TIA::hmm0(uint8_t val) {
-  missile0_motion = -(((int8_t)(val & 0xF0)) / 16);
+  state.missile0_motion = -(((int8_t)(val & 0xF0)) / 16);
 }
 
 void TIA::hmm1(uint8_t val) {
-  missile1_motion = -(((int8_t)(val & 0xF0)) / 16);
+  state.missile1_motion = -(((int8_t)(val & 0xF0)) / 16);
 }
 
 // Set ball "motion".
 // Upper 4 bits represent a signed 4 bit value.
-void TIA::hmbl(uint8_t val) { ball_motion = -(((int8_t)(val & 0xF0)) / 16); }
+void TIA::hmbl(uint8_t val) {
+  state.ball_motion = -(((int8_t)(val & 0xF0)) / 16);
+}
 
 // Delay setting GRP0 until GRP1 is set.
 // Only bit 0 is used.
-void TIA::vdelp0(uint8_t val) { player0_mask_delay = val & 0x01; }
+void TIA::vdelp0(uint8_t val) { state.player0_mask_delay = val & 0x01; }
 
 // Delay setting GRP1 until GRP0 is set.
 // Only bit 0 is used.
-void TIA::vdelp1(uint8_t val) { player1_mask_delay = val & 0x01; }
+void TIA::vdelp1(uint8_t val) { state.player1_mask_delay = val & 0x01; }
 
 // Delay setting ENABL until GRP1 is set.
 // Only bit 0 is used..
-void TIA::vdelbl(uint8_t val) { ball_enable_delay = val & 0x01; }
+void TIA::vdelbl(uint8_t val) { state.ball_enable_delay = val & 0x01; }
 
 void TIA::handle_resmp(int player_scale, int player_x, int &missile_x) {
   switch (player_scale) {
@@ -479,7 +866,7 @@ void TIA::handle_resmp(int player_scale, int player_x, int &missile_x) {
     break;
   default:
     printf("Error! Invalid player scale for RESMP call!\n");
-    panic();
+    exit(-1);
     break;
   }
 }
@@ -488,55 +875,50 @@ void TIA::handle_resmp(int player_scale, int player_x, int &missile_x) {
 // depending on the player scale. Only bit 1 is used.
 void TIA::resmp0(uint8_t val) {
   if (val & 0x02)
-    handle_resmp(player0_scale, player0_x, missile0_x);
+    handle_resmp(state.player0_scale, state.player0_x, state.missile0_x);
+  dirty_lines |= missile0_bit;
 }
 
 void TIA::resmp1(uint8_t val) {
   if (val & 0x02)
-    handle_resmp(player1_scale, player1_x, missile1_x);
+    handle_resmp(state.player1_scale, state.player1_x, state.missile1_x);
+  dirty_lines |= missile1_bit;
 }
 
 // Change sprite positions based on their "motion" registers. Sprites cannot go
 // offscreen from this, so we implement a modulo.
 void TIA::hmove(uint8_t val) {
-  player0_x += player0_motion;
-  player0_x = mod(player0_x, NTSC::visible_columns);
-  player1_x += player1_motion;
-  player1_x = mod(player1_x, NTSC::visible_columns);
-  missile0_x += missile0_motion;
-  missile0_x = mod(missile0_x, NTSC::visible_columns);
-  missile1_x += missile1_motion;
-  missile1_x = mod(missile1_x, NTSC::visible_columns);
-  ball_x += ball_motion;
-  ball_x = mod(ball_x, NTSC::visible_columns);
+  state.player0_x += state.player0_motion;
+  state.player0_x = mod(state.player0_x, NTSC::visible_columns);
+  state.player1_x += state.player1_motion;
+  state.player1_x = mod(state.player1_x, NTSC::visible_columns);
+  state.missile0_x += state.missile0_motion;
+  state.missile0_x = mod(state.missile0_x, NTSC::visible_columns);
+  state.missile1_x += state.missile1_motion;
+  state.missile1_x = mod(state.missile1_x, NTSC::visible_columns);
+  state.ball_x += state.ball_motion;
+  state.ball_x = mod(state.ball_x, NTSC::visible_columns);
+  dirty_lines |=
+      player0_bit | player1_bit | missile0_bit | missile1_bit | ball_bit;
 }
 
 // Clear motion registers.
 void TIA::hmclr(uint8_t val) {
-  player0_motion = 0;
-  player1_motion = 0;
-  missile0_motion = 0;
-  missile1_motion = 0;
-  ball_motion = 0;
+  state.player0_motion = 0;
+  state.player1_motion = 0;
+  state.missile0_motion = 0;
+  state.missile1_motion = 0;
+  state.ball_motion = 0;
 }
 
 // Clear collision registers
 void TIA::cxclr(uint8_t val) {
-  missile0_player1 = false;
-  missile0_player0 = false;
-  missile1_player0 = false;
-  missile1_player1 = false;
-  player0_playfield = false;
-  player0_ball = false;
-  player1_playfield = false;
-  player1_ball = false;
-  missile0_playfield = false;
-  missile0_ball = false;
-  missile1_playfield = false;
-  missile1_ball = false;
-  ball_playfield = false;
-  player0_player1 = false;
-  missile0_missile1 = false;
+  // Anything drawn so far happened before the clear, so there's no need to
+  // work it out.
+  num_pending_lines = 0;
+  lines.drawn.clear();
+  lines.playfield_drawn.clear();
+  regs.collisions = 0;
 }
 
 // Collision registers have a quirk where they return 0x02 bitwise OR'd with the actual collision values.
@@ -544,46 +926,55 @@ void TIA::cxclr(uint8_t val) {
 // Bit 7 set if missile 0 and player 0 collided.
 // Bit 6 set if missile 0 and player 1 collided.
 uint8_t TIA::cxm0p() {
-  return (uint8_t)missile0_player1 << 7 | (uint8_t)missile0_player0 << 6 | 0x02;
+  return (uint8_t)!!(regs.collisions & missile0_player1) << 7 |
+         (uint8_t)!!(regs.collisions & missile0_player0) << 6 | 0x02;
 }
 
 // Bit 7 set if missile 1 and player 0 collided.
 // Bit 6 set if missile 1 and player 1 collided.
 uint8_t TIA::cxm1p() {
-  return (uint8_t)missile1_player0 << 7 | (uint8_t)missile1_player1 << 6 | 0x02;
+  return (uint8_t)!!(regs.collisions & missile1_player0) << 7 |
+         (uint8_t)!!(regs.collisions & missile1_player1) << 6 | 0x02;
 }
 
 // Bit 7 set if player 0 and playfield collided.
 // Bit 6 set if player 0 and ball collided.
 uint8_t TIA::cxp0fb() {
-  return (uint8_t)player0_playfield << 7 | (uint8_t)player0_ball << 6 | 0x02;
+  return (uint8_t)!!(regs.collisions & player0_playfield) << 7 |
+         (uint8_t)!!(regs.collisions & player0_ball) << 6 | 0x02;
 }
 
 // Bit 7 set if player 1 and playfield collided.
 // Bit 6 set if player 1 and ball collided.
 uint8_t TIA::cxp1fb() {
-  return (uint8_t)player1_playfield << 7 | (uint8_t)player1_ball << 6 | 0x02;
+  return (uint8_t)!!(regs.collisions & player1_playfield) << 7 |
+         (uint8_t)!!(regs.collisions & player1_ball) << 6 | 0x02;
 }
 
 // Bit 7 set if missile 0 and playfield collided.
 // Bit 6 set if missile 0 and ball collided.
 uint8_t TIA::cxm0fb() {
-  return (uint8_t)missile0_playfield << 7 | (uint8_t)missile0_ball << 6 | 0x02;
+  return (uint8_t)!!(regs.collisions & missile0_playfield) << 7 |
+         (uint8_t)!!(regs.collisions & missile0_ball) << 6 | 0x02;
 }
 
 // Bit 7 set if missile 1 and playfield collided.
 // Bit 6 set if missile 1 and ball collided.
 uint8_t TIA::cxm1fb() {
-  return (uint8_t)missile1_playfield << 7 | (uint8_t)missile1_ball << 6 | 0x02;
+  return (uint8_t)!!(regs.collisions & missile1_playfield) << 7 |
+         (uint8_t)!!(regs.collisions & missile1_ball) << 6 | 0x02;
 }
 
 // Bit 7 set ball and playfield collided.
-uint8_t TIA::cxblpf() { return (uint8_t)ball_playfield << 7 | 0x02; }
+uint8_t TIA::cxblpf() {
+  return (uint8_t)!!(regs.collisions & ball_playfield) << 7 | 0x02;
+}
 
 // Bit 7 set if player 0 and player 1 collided.
 // Bit 6 set if missile 0 and missile 1 collided.
 uint8_t TIA::cxppmm() {
-  return (uint8_t)player0_player1 << 7 | (uint8_t)missile0_missile1 << 6 | 0x02;
+  return (uint8_t)!!(regs.collisions & player0_player1) << 7 |
+         (uint8_t)!!(regs.collisions & missile0_missile1) << 6 | 0x02;
 }
 
 // TODO: Implement actual joystick controls
@@ -600,174 +991,306 @@ uint8_t TIA::inpt2() { return 0; }
 uint8_t TIA::inpt3() { return 0; }
 
 // Bit 7 set to player 0 fire button.
-uint8_t TIA::inpt4() { return ~(uint8_t)player0_fire << 7; }
+uint8_t TIA::inpt4() { return ~(uint8_t)controls.player0_fire << 7; }
 
 // Bit 7 set to player 1 fire button.
-uint8_t TIA::inpt5() { return ~(uint8_t)player1_fire << 7; }
+uint8_t TIA::inpt5() { return ~(uint8_t)controls.player1_fire << 7; }
 
-// See more info on Atari 2600 sound in the sounds directory
+// See sound.cc for more info on Atari 2600 sound. Everything up to the write
+// has to be synthesized with the old register values first.
 
 // Set audio channel 0 volume
-void TIA::audv0(uint8_t val) { volume0 = val; }
+void TIA::audv0(uint8_t val) {
+  sound.catch_up(cycle_num);
+  sound.set_volume(0, val);
+}
 
 // Set audio channel 1 volume
-void TIA::audv1(uint8_t val) { volume1 = val; }
+void TIA::audv1(uint8_t val) {
+  sound.catch_up(cycle_num);
+  sound.set_volume(1, val);
+}
 
 // Set audio channel 0 *sampling* frequency
-void TIA::audf0(uint8_t val) { freq0 = val; }
+void TIA::audf0(uint8_t val) {
+  sound.catch_up(cycle_num);
+  sound.set_freq(0, val);
+}
 
 // Set audio channel 1 *sampling* frequency
-void TIA::audf1(uint8_t val) { freq1 = val; }
+void TIA::audf1(uint8_t val) {
+  sound.catch_up(cycle_num);
+  sound.set_freq(1, val);
+}
 
 // Set audio channel 0 waveform
-void TIA::audc0(uint8_t val) { noise_control0 = val; }
+void TIA::audc0(uint8_t val) {
+  sound.catch_up(cycle_num);
+  sound.set_control(0, val);
+}
 
 // Set audio channel 1 waveform
-void TIA::audc1(uint8_t val) { noise_control1 = val; }
-
-TIA::TIA(int scale) {
-  ntsc = std::make_unique<NTSC>(scale);
-
-  memory_region = std::make_shared<MappedRegion>(
-      TIA_START, TIA_END, std::bind(&TIA::memory_read_hook, this, _1),
-      std::bind(&TIA::memory_write_hook, this, _1, _2));
-  tia_cycle_num = tia_cycle_ratio * cycle_num;
-  last_process_cycle_num = cycle_num;
-
-  memory_write_table[0x00] = std::bind(&TIA::vsync, this, _1);
-  memory_write_table[0x01] = std::bind(&TIA::vblank, this, _1);
-  memory_write_table[0x02] = std::bind(&TIA::wsync, this, _1);
-  memory_write_table[0x03] = std::bind(&TIA::rsync, this, _1);
-  memory_write_table[0x04] = std::bind(&TIA::nusiz0, this, _1);
-  memory_write_table[0x05] = std::bind(&TIA::nusiz1, this, _1);
-  memory_write_table[0x06] = std::bind(&TIA::colup0, this, _1);
-  memory_write_table[0x07] = std::bind(&TIA::colup1, this, _1);
-  memory_write_table[0x08] = std::bind(&TIA::colupf, this, _1);
-  memory_write_table[0x09] = std::bind(&TIA::colubk, this, _1);
-  memory_write_table[0x0A] = std::bind(&TIA::ctrlpf, this, _1);
-  memory_write_table[0x0B] = std::bind(&TIA::refp0, this, _1);
-  memory_write_table[0x0C] = std::bind(&TIA::refp1, this, _1);
-  memory_write_table[0x0D] = std::bind(&TIA::pf0, this, _1);
-  memory_write_table[0x0E] = std::bind(&TIA::pf1, this, _1);
-  memory_write_table[0x0F] = std::bind(&TIA::pf2, this, _1);
-  memory_write_table[0x10] = std::bind(&TIA::resp0, this, _1);
-  memory_write_table[0x11] = std::bind(&TIA::resp1, this, _1);
-  memory_write_table[0x12] = std::bind(&TIA::resm0, this, _1);
-  memory_write_table[0x13] = std::bind(&TIA::resm1, this, _1);
-  memory_write_table[0x14] = std::bind(&TIA::resbl, this, _1);
-  memory_write_table[0x15] = std::bind(&TIA::audc0, this, _1);
-  memory_write_table[0x16] = std::bind(&TIA::audc1, this, _1);
-  memory_write_table[0x17] = std::bind(&TIA::audf0, this, _1);
-  memory_write_table[0x18] = std::bind(&TIA::audf1, this, _1);
-  memory_write_table[0x19] = std::bind(&TIA::audv0, this, _1);
-  memory_write_table[0x1A] = std::bind(&TIA::audv1, this, _1);
-  memory_write_table[0x1B] = std::bind(&TIA::grp0, this, _1);
-  memory_write_table[0x1C] = std::bind(&TIA::grp1, this, _1);
-  memory_write_table[0x1D] = std::bind(&TIA::enam0, this, _1);
-  memory_write_table[0x1E] = std::bind(&TIA::enam1, this, _1);
-  memory_write_table[0x1F] = std::bind(&TIA::enabl, this, _1);
-  memory_write_table[0x20] = std::bind(&TIA::hmp0, this, _1);
-  memory_write_table[0x21] = std::bind(&TIA::hmp1, this, _1);
-  memory_write_table[0x22] = std::bind(&TIA::hmm0, this, _1);
-  memory_write_table[0x23] = std::bind(&TIA::hmm1, this, _1);
-  memory_write_table[0x24] = std::bind(&TIA::hmbl, this, _1);
-  memory_write_table[0x25] = std::bind(&TIA::vdelp0, this, _1);
-  memory_write_table[0x26] = std::bind(&TIA::vdelp1, this, _1);
-  memory_write_table[0x27] = std::bind(&TIA::vdelbl, this, _1);
-  memory_write_table[0x28] = std::bind(&TIA::resmp0, this, _1);
-  memory_write_table[0x29] = std::bind(&TIA::resmp1, this, _1);
-  memory_write_table[0x2A] = std::bind(&TIA::hmove, this, _1);
-  memory_write_table[0x2B] = std::bind(&TIA::hmclr, this, _1);
-  memory_write_table[0x2C] = std::bind(&TIA::cxclr, this, _1);
-
-  memory_read_table[0x00] = std::bind(&TIA::cxm0p, this);
-  memory_read_table[0x01] = std::bind(&TIA::cxm1p, this);
-  memory_read_table[0x02] = std::bind(&TIA::cxp0fb, this);
-  memory_read_table[0x03] = std::bind(&TIA::cxp1fb, this);
-  memory_read_table[0x04] = std::bind(&TIA::cxm0fb, this);
-  memory_read_table[0x05] = std::bind(&TIA::cxm1fb, this);
-  memory_read_table[0x06] = std::bind(&TIA::cxblpf, this);
-  memory_read_table[0x07] = std::bind(&TIA::cxppmm, this);
-  memory_read_table[0x08] = std::bind(&TIA::inpt0, this);
-  memory_read_table[0x09] = std::bind(&TIA::inpt1, this);
-  memory_read_table[0x0A] = std::bind(&TIA::inpt2, this);
-  memory_read_table[0x0B] = std::bind(&TIA::inpt3, this);
-  memory_read_table[0x0C] = std::bind(&TIA::inpt4, this);
-  memory_read_table[0x0D] = std::bind(&TIA::inpt5, this);
-
-  for (int i = 0; i < 0x40; i++)
-    memory_write_table[i + 0x40] = memory_write_table[i];
-
-  for (int i = 0x10; i < 0x80; i += 0x10) {
-    for (int j = 0; j < 0x10; j++)
-      memory_read_table[j + i] = memory_read_table[j];
+void TIA::audc1(uint8_t val) {
+  sound.catch_up(cycle_num);
+  sound.set_control(1, val);
+}
+
+TIA::TIA(Registers &regs, uint64_t &cycle_num, const Controls &controls,
+         int scale, double speed, bool pipelined, bool headless)
+    : TIA(regs, cycle_num, controls,
+          pipelined || headless ? std::make_unique<NTSC>(nullptr, speed, true)
+                                : std::make_unique<NTSC>(scale, speed)) {
+  if (headless) {
+    draw_pixels = false;
+  } else if (pipelined) {
+    draw_pixels = false;
+    pipeline = std::make_unique<TIAPipeline>(*this, scale);
   }
+
+  start_frame();
+}
+
+TIA::TIA(Registers &regs, uint64_t &cycle_num, const Controls &controls,
+         std::unique_ptr<Display> display)
+    : TIA(regs, cycle_num, controls,
+          std::make_unique<NTSC>(std::move(display), 0, false)) {
+  follows_frameskip = false;
+  sound.mute();
+}
+
+TIA::~TIA() {}
+
+TIA::TIA(Registers &regs, uint64_t &cycle_num, const Controls &controls,
+         std::unique_ptr<NTSC> ntsc)
+    : cycle_num(cycle_num), controls(controls), regs(regs), state(regs.state),
+      sound(cycle_num) {
+  this->ntsc = std::move(ntsc);
+
+  regs = Registers();
+  regs.tia_cycle_num = tia_cycle_ratio * cycle_num;
+  regs.last_process_cycle_num = cycle_num;
+  rendered_cycle_num = cycle_num;
+  line_cache.resize(line_cache_size);
+}
+
+void TIA::catch_up() {
+  render((regs.last_process_cycle_num - rendered_cycle_num) * tia_cycle_ratio);
+  rendered_cycle_num = regs.last_process_cycle_num;
+}
+
+void TIA::flush() {
+  catch_up();
+  if (deferring_line)
+    abandon_line();
 }
 
 void TIA::process_tia() {
-  // It's important we process the TIA cycles before the write requests so we
-  // get the timing of the "reset sprite position" registers correct. They
-  // should always happen at the end of the last clock cycle.
-  for (uint64_t i = 0; i < cycle_num - last_process_cycle_num; i++) {
-    for (int j = 0; j < tia_cycle_ratio; j++)
-      process_tia_cycle();
+  regs.last_process_cycle_num = cycle_num;
+
+  if (pending_write.valid) {
+    // It's important we process the TIA cycles before the write requests so
+    // we get the timing of the "reset sprite position" registers correct.
+    // They should always happen at the end of the last clock cycle.
+    catch_up();
+    if (trace)
+      trace->log_write(cycle_num, pending_write.addr, pending_write.val);
+    write_register(pending_write.addr & 0x3F, pending_write.val);
+
+    pending_write.valid = false;
   }
 
-  last_process_cycle_num = cycle_num;
+  if (sound.batch_due(cycle_num))
+    sound.catch_up(cycle_num);
+}
+
+void TIA::start_trace(const char *filename) {
+  trace = std::make_unique<TIATraceWriter>(filename, *this);
+}
+
+void TIA::start_wav(const char *filename) { sound.start_wav(filename); }
+
+void TIA::stop_wav() {
+  sound.catch_up(cycle_num);
+  sound.stop_wav();
+}
 
-  if (memory_write_request) {
-    memory_write_request(memory_val);
-    memory_write_request = nullptr;
-    memory_val = 0;
+void TIA::set_drawing(bool drawing) {
+  drawing_frame = drawing;
+  draw_pixels = drawing;
+  ntsc->draw_frame = drawing;
+}
+
+void TIA::save_state(Snapshot &snapshot) {
+  // Nothing held back for the scanline cache or waiting on collisions, so the
+  // object lines can just be rebuilt from |state|.
+  flush();
+  resolve_collisions();
+
+  ntsc->save_state(snapshot.ntsc);
+  sound.save_state(snapshot.sound);
+}
+
+void TIA::load_state(const Snapshot &snapshot) {
+  rendered_cycle_num = regs.last_process_cycle_num;
+  ntsc->load_state(snapshot.ntsc);
+  sound.load_state(snapshot.sound);
+
+  deferring_line = false;
+  pending_write.valid = false;
+  num_pending_lines = 0;
+  lines.drawn.clear();
+  lines.playfield_drawn.clear();
+  dirty_lines = all_objects;
+
+  start_frame();
+}
+
+void TIA::start_frame() {
+  if (!follows_frameskip)
+    return;
+
+  int skip = frameskip;
+  drawing_frame = skip && ntsc->frames % skip == 0;
+
+  // In pipelined mode we never draw here anyway, we just don't hand the frame
+  // to the render thread.
+  if (!pipeline) {
+    draw_pixels = drawing_frame;
+    ntsc->draw_frame = drawing_frame;
+  }
+}
+
+void TIA::write_register(uint8_t addr, uint8_t val) {
+  WriteHandler write_func = write_handlers[addr];
+
+  if (addr == 0x02 || (addr >= 0x15 && addr <= 0x1A)) {
+    // WSYNC and the audio registers have nothing to do with drawing, so
+    // they happen right away even if the scanline is held.
+    (this->*write_func)(val);
+    return;
+  }
+
+  // The render thread needs to see everything else except CXCLR, since it
+  // doesn't keep track of collisions.
+  if (pipeline && addr != 0x2C)
+    pipeline->log_write(regs.tia_cycle_num, addr, val);
+
+  if (addr == 0x00 || addr == 0x03 || addr == 0x2C) {
+    // VSYNC and RSYNC move the electron gun, and CXCLR needs every collision
+    // before it, so everything has to be drawn first.
+    flush();
+    (this->*write_func)(val);
+    return;
+  }
+
+  if (!deferring_line)
+    start_line();
+
+  if (deferring_line && num_line_writes < max_line_writes) {
+    line_writes[num_line_writes++] = {(uint8_t)line_cycles, addr, val};
+  } else {
+    if (deferring_line)
+      abandon_line();
+    (this->*write_func)(val);
   }
 }
 
+void TIA::replay_write(int64_t tia_cycle, uint8_t addr, uint8_t val) {
+  render(tia_cycle - regs.tia_cycle_num);
+  write_register(addr, val);
+}
+
+void TIA::start_replay(const State &start_state, int64_t start_tia_cycle,
+                       int gun_x, int gun_y, bool start_vsync_mode) {
+  state = start_state;
+  regs.vsync_mode = start_vsync_mode;
+  dirty_lines = all_objects;
+  regs.tia_cycle_num = start_tia_cycle;
+  ntsc->gun_x = gun_x;
+  ntsc->gun_y = gun_y;
+
+  // The frame the render thread gets next has to start from here too.
+  if (pipeline)
+    pipeline->begin_frame();
+}
+
+void TIA::set_lossless_pipeline() {
+  if (pipeline)
+    pipeline->lossless = true;
+}
+
+void TIA::drain_pipeline() {
+  if (pipeline)
+    pipeline->drain();
+}
+
 void TIA::dump_tia() {
-  printf("TIA cycle num: %lu\n", tia_cycle_num);
+  flush();
+  resolve_collisions();
+
+  printf("TIA cycle num: %lu\n", regs.tia_cycle_num);
 
   printf("Gun X: %d  Gun Y: %d\n", ntsc->gun_x, ntsc->gun_y);
+  printf("Frames: %lu\n", ntsc->frames);
 
-  printf("Background color: %x\n", background_color);
+  printf("Background color: %x\n", state.background_color);
 
-  printf("Playfield / ball color: %x\n", playfield_color);
+  printf("Playfield / ball color: %x\n", state.playfield_color);
   printf("Playfield mask: ");
   for (int i = 0; i < 40; i++)
-    printf("%c", ((playfield_mask >> i) & 0x01) ? '#' : '_');
+    printf("%c", ((state.playfield_mask >> i) & 0x01) ? '#' : '_');
   printf("\n");
 
-  printf("Player 0 / Missile 0 color: %x\n", player0_color);
-  printf("Player 0 X: %d   Player 0 motion: %d\n", player0_x, player0_motion);
+  printf("Player 0 / Missile 0 color: %x\n", state.player0_color);
+  printf("Player 0 X: %d   Player 0 motion: %d\n", state.player0_x,
+         state.player0_motion);
   printf("Player 0 mask: ");
   for (int i = 0; i < 8; i++)
-    printf("%c", ((player0_mask >> i) & 0x01) ? '#' : '_');
+    printf("%c", ((state.player0_mask >> i) & 0x01) ? '#' : '_');
   printf("\n");
-  printf("Missile 0 enabled: %s\n", missile0_enable ? "true" : "false");
-  printf("Missile 0 size: %d\n", missile0_size);
-  printf("Missile 0 X: %d  Missile 0 motion: %d\n", missile0_x,
-         missile0_motion);
-  printf("Player 0 scale: %d\n", player0_scale);
+  printf("Missile 0 enabled: %s\n", state.missile0_enable ? "true" : "false");
+  printf("Missile 0 size: %d\n", state.missile0_size);
+  printf("Missile 0 X: %d  Missile 0 motion: %d\n", state.missile0_x,
+         state.missile0_motion);
+  printf("Player 0 scale: %d\n", state.player0_scale);
   printf("Player-missile 0 copy mask: ");
   for (int i = 0; i < 10; i++)
-    printf("%c", ((player0_duplicate_mask >> i) & 0x01) ? '#' : '_');
+    printf("%c", ((state.player0_duplicate_mask >> i) & 0x01) ? '#' : '_');
   printf("\n");
 
-  printf("Player 1 / Missile 1 color: %x\n", player1_color);
-  printf("Player 1 X: %d   Player 1 motion: %d\n", player1_x, player1_motion);
+  printf("Player 1 / Missile 1 color: %x\n", state.player1_color);
+  printf("Player 1 X: %d   Player 1 motion: %d\n", state.player1_x,
+         state.player1_motion);
   printf("Player 1 mask: ");
   for (int i = 0; i < 8; i++)
-    printf("%c", ((player1_mask >> i) & 0x01) ? '#' : '_');
+    printf("%c", ((state.player1_mask >> i) & 0x01) ? '#' : '_');
   printf("\n");
-  printf("Missile 1 enabled: %s\n", missile1_enable ? "true" : "false");
-  printf("Missile 1 size: %d\n", missile1_size);
-  printf("Missile 1 X: %d  Missile 1 motion: %d\n", missile1_x,
-         missile1_motion);
-  printf("Player 1 scale: %d\n", player1_scale);
+  printf("Missile 1 enabled: %s\n", state.missile1_enable ? "true" : "false");
+  printf("Missile 1 size: %d\n", state.missile1_size);
+  printf("Missile 1 X: %d  Missile 1 motion: %d\n", state.missile1_x,
+         state.missile1_motion);
+  printf("Player 1 scale: %d\n", state.player1_scale);
   printf("Player-missile 1 copy mask: ");
   for (int i = 0; i < 10; i++)
-    printf("%c", ((player1_duplicate_mask >> i) & 0x01) ? '#' : '_');
+    printf("%c", ((state.player1_duplicate_mask >> i) & 0x01) ? '#' : '_');
   printf("\n");
 
-  printf("Ball enabled: %s\n", ball_enable ? "true" : "false");
-  printf("Ball size: %d\n", ball_size);
-  printf("Ball X: %d  Ball motion: %d\n", ball_x, ball_motion);
+  printf("Ball enabled: %s\n", state.ball_enable ? "true" : "false");
+  printf("Ball size: %d\n", state.ball_size);
+  printf("Ball X: %d  Ball motion: %d\n", state.ball_x, state.ball_motion);
+
+  printf("CXM0P: %x  CXM1P: %x  CXP0FB: %x  CXP1FB: %x\n", cxm0p(), cxm1p(),
+         cxp0fb(), cxp1fb());
+  printf("CXM0FB: %x  CXM1FB: %x  CXBLPF: %x  CXPPMM: %x\n", cxm0fb(), cxm1fb(),
+         cxblpf(), cxppmm());
+
+  dump_line_cache_stats();
+}
+
+void TIA::dump_line_cache_stats() {
+  uint64_t lines = line_cache_hits + line_cache_misses + lines_uncached;
+  printf("Scanline cache: %lu hits  %lu misses  %lu uncached  (%.1f%% hit "
+         "rate)\n",
+         line_cache_hits, line_cache_misses, lines_uncached,
+         lines ? 100.0 * line_cache_hits / lines : 0.0);
 }
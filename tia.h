@@ -1,119 +1,313 @@
-#include <functional>
 #include <memory>
+#include <vector>
 #include <stdint.h>
+#include <type_traits>
 
-#include "memory.h"
+#include "display.h"
+#include "input.h"
+#include "line_mask.h"
 #include "ntsc.h"
+#include "sound.h"
 
 #ifndef TIA_H
 #define TIA_H
 
+class TIAPipeline;
+class TIATraceWriter;
+
 class TIA {
-  std::shared_ptr<MappedRegion> memory_region;
-  int64_t tia_cycle_num;
-  uint64_t last_process_cycle_num;
-  bool vsync_mode = false;
-  bool vblank_mode = false;
-
-  uint8_t background_color = 0;
-
-  uint64_t playfield_mask = 0;
-  uint8_t playfield_color = 0;
-  bool playfield_mirrored = false;
-  bool playfield_score_mode = false;
-  bool playfield_priority = false;
-
-  int player0_x = 0;
-  int player0_motion = 0;
-  int player1_x = 0;
-  int player1_motion = 0;
-  uint8_t player0_mask = 0;
-  uint8_t player0_mask_buf = 0;
-  bool player0_mask_delay = false;
-  uint8_t player1_mask = 0;
-  uint8_t player1_mask_buf = 0;
-  bool player1_mask_delay = false;
-  uint8_t player0_color = 0;
-  uint8_t player1_color = 0;
-  int player0_scale = 1;
-  int player1_scale = 1;
-  int player0_duplicate_mask = 0;
-  int player1_duplicate_mask = 0;
-  bool player0_reflect = false;
-  bool player1_reflect = false;
-
-  int missile0_x = 0;
-  int missile0_motion = 0;
-  int missile1_x = 0;
-  int missile1_motion = 0;
-  int missile0_size = 1;
-  int missile1_size = 1;
-  bool missile0_enable = false;
-  bool missile1_enable = false;
-
-  int ball_x = 0;
-  int ball_motion = 0;
-  int ball_size = 1;
-  bool ball_enable = false;
-  bool ball_enable_buf = false;
-  bool ball_enable_delay = false;
-
-  // Collisions
-  bool missile0_player1 = false;
-  bool missile0_player0 = false;
-  bool missile1_player0 = false;
-  bool missile1_player1 = false;
-  bool player0_playfield = false;
-  bool player0_ball = false;
-  bool player1_playfield = false;
-  bool player1_ball = false;
-  bool missile0_playfield = false;
-  bool missile0_ball = false;
-  bool missile1_playfield = false;
-  bool missile1_ball = false;
-  bool ball_playfield = false;
-  bool player0_player1 = false;
-  bool missile0_missile1 = false;
-
-  uint8_t memory_val = 0;
-  std::function<void(uint8_t)> memory_write_request = nullptr;
-
-  std::function<uint8_t(void)> memory_read_table[128] = {nullptr};
-  std::function<void(uint8_t)> memory_write_table[128] = {nullptr};
-
-  uint8_t memory_read_hook(uint16_t addr);
-  void memory_write_hook(uint16_t addr, uint8_t val);
-
-  void process_tia_cycle();
+  friend class TIAPipeline;
+  friend class TIATraceWriter;
+  friend class TIATraceReader;
+  friend struct TIATraceHeader;
+
+  // The CPU's cycle counter, which everything here is timed against.
+  uint64_t &cycle_num;
+  // The fire buttons, which are read through INPT4 and INPT5.
+  const Controls &controls;
+
+public:
+  // Everything that decides what the TIA draws. This is kept together so
+  // scanlines can be looked up by the state they started with. It's laid out
+  // without implicit padding so it can be hashed and compared as plain bytes.
+  // The flags are packed into bits, and since bit-fields can't have default
+  // values, a State has to be value initialized, State() rather than State.
+  struct State {
+    uint64_t playfield_mask = 0;
+
+    int player0_x = 0;
+    int player0_motion = 0;
+    int player1_x = 0;
+    int player1_motion = 0;
+    int player0_scale = 1;
+    int player1_scale = 1;
+    int player0_duplicate_mask = 0;
+    int player1_duplicate_mask = 0;
+
+    int missile0_x = 0;
+    int missile0_motion = 0;
+    int missile1_x = 0;
+    int missile1_motion = 0;
+    int missile0_size = 1;
+    int missile1_size = 1;
+
+    int ball_x = 0;
+    int ball_motion = 0;
+    int ball_size = 1;
+
+    uint8_t background_color = 0;
+    uint8_t playfield_color = 0;
+    uint8_t player0_mask = 0;
+    uint8_t player0_mask_buf = 0;
+    uint8_t player1_mask = 0;
+    uint8_t player1_mask_buf = 0;
+    uint8_t player0_color = 0;
+    uint8_t player1_color = 0;
+
+    bool vblank_mode : 1;
+    bool playfield_mirrored : 1;
+    bool playfield_score_mode : 1;
+    bool playfield_priority : 1;
+    bool player0_mask_delay : 1;
+    bool player1_mask_delay : 1;
+    bool player0_reflect : 1;
+    bool player1_reflect : 1;
+    bool missile0_enable : 1;
+    bool missile1_enable : 1;
+    bool ball_enable : 1;
+    bool ball_enable_buf : 1;
+    bool ball_enable_delay : 1;
+    // Named, so value initialization clears them along with the rest.
+    bool padding_bit0 : 1;
+    bool padding_bit1 : 1;
+    bool padding_bit2 : 1;
+
+    uint8_t padding[2] = {0};
+  };
+  static_assert(sizeof(State) == 88 &&
+                    std::has_unique_object_representations_v<State>,
+                "TIA::State must not have any padding");
+
+  // The registers, and the counters the TIA is timed by. A console keeps
+  // these with the rest of its state, so a TIA is handed a block of its own
+  // when it's built, the same as the CPU's cycle counter. The TIA puts it in
+  // its power on state.
+  struct Registers {
+    int64_t tia_cycle_num;
+    // The CPU cycle we have processed up to.
+    uint64_t last_process_cycle_num;
+    // See CollisionBits.
+    uint16_t collisions;
+    bool vsync_mode;
+    uint8_t padding[5];
+    State state;
+  };
+
+private:
+  Registers &regs;
+  // |regs.state|, which nearly everything here works on.
+  State &state;
+
+  // One bit for each object the TIA draws.
+  enum ObjectBits {
+    player0_bit = 1 << 0,
+    player1_bit = 1 << 1,
+    missile0_bit = 1 << 2,
+    missile1_bit = 1 << 3,
+    ball_bit = 1 << 4,
+    playfield_bit = 1 << 5,
+    all_objects = (1 << 6) - 1,
+  };
+
+  // Collisions. Each bit latches once the two objects overlap, until CXCLR.
+  // These are only brought up to date by resolve_collisions().
+  enum CollisionBits {
+    missile0_player1 = 1 << 0,
+    missile0_player0 = 1 << 1,
+    missile1_player0 = 1 << 2,
+    missile1_player1 = 1 << 3,
+    player0_playfield = 1 << 4,
+    player0_ball = 1 << 5,
+    player1_playfield = 1 << 6,
+    player1_ball = 1 << 7,
+    missile0_playfield = 1 << 8,
+    missile0_ball = 1 << 9,
+    missile1_playfield = 1 << 10,
+    missile1_ball = 1 << 11,
+    ball_playfield = 1 << 12,
+    player0_player1 = 1 << 13,
+    missile0_missile1 = 1 << 14,
+  };
+
+  // Pixels each object covers on a scanline. These only change when the CPU
+  // writes one of the registers they depend on, so we rebuild them lazily and
+  // composite whole runs of pixels with bitwise ops.
+  struct ObjectLines {
+    LineMask player0;
+    LineMask player1;
+    LineMask missile0;
+    LineMask missile1;
+    LineMask ball;
+    LineMask playfield;
+
+    // Line positions drawn while the object lines looked like this. Sprites
+    // wrap around into the horizontal blank but the playfield doesn't, so it
+    // gets its own.
+    LineMask drawn;
+    LineMask playfield_drawn;
+  };
+  ObjectLines lines;
+  // ObjectBits of the lines that need rebuilding.
+  int dirty_lines = all_objects;
+
+  // Few games read every collision register, so we don't work out collisions
+  // while drawing. Instead we keep the object lines from before each rebuild,
+  // along with where they were drawn, and AND them together when somebody
+  // actually asks.
+  const static int max_pending_lines = 64;
+  ObjectLines pending_lines[max_pending_lines];
+  int num_pending_lines = 0;
+
+  // The TIA only ever changes state when the CPU writes a register, so rather
+  // than drawing every color clock as it happens, we let them pile up and
+  // render them in one go right before the next write. This is the CPU cycle
+  // we have rendered up to.
+  uint64_t rendered_cycle_num;
+
+  // Scanline cache. Frames tend to repeat the same scanlines over and over,
+  // so we hold off on each scanline until it's over and we know every write
+  // that happened during it. If we've already drawn a scanline that started
+  // with the same state and saw the same writes at the same cycles, we copy
+  // its pixels and collisions instead of drawing it again.
+  struct QueuedWrite {
+    // TIA cycle within the scanline
+    uint8_t cycle;
+    uint8_t addr;
+    uint8_t val;
+  };
+  const static int max_line_writes = 32;
+
+  struct CachedLine {
+    bool valid = false;
+    State state;
+    // Where the scanline started relative to the TIA clock, since the RESxx
+    // registers go by that.
+    int phase;
+    int num_writes;
+    QueuedWrite writes[max_line_writes];
+
+    uint8_t pixels[NTSC::visible_columns];
+    uint16_t collisions;
+  };
+  const static int line_cache_size = 256;
+  std::vector<CachedLine> line_cache;
+
+  // The scanline we're holding off on. Writes are queued up rather than
+  // applied, so |state| is still the state the scanline started with.
+  bool deferring_line = false;
+  int64_t line_start_tia_cycle;
+  int line_cycles;
+  QueuedWrite line_writes[max_line_writes];
+  int num_line_writes;
+
+  // Visible pixels of the scanline being drawn, for filling the cache.
+  uint8_t line_pixels[NTSC::visible_columns];
+
+  uint64_t line_cache_hits = 0;
+  uint64_t line_cache_misses = 0;
+  // Scanlines we had to draw as they happened, because something needed to
+  // see them before they were over.
+  uint64_t lines_uncached = 0;
+
+  // In pipelined mode the emulation thread's TIA only keeps track of
+  // collisions, and a second TIA on a render thread draws the pixels from a
+  // log of register writes. These say which half of the work this TIA does.
+  bool draw_pixels = true;
+  bool track_collisions = true;
+  std::unique_ptr<TIAPipeline> pipeline;
+
+  // Whether the current frame gets drawn, going by |frameskip|. Skipped
+  // frames still keep track of the gun, object positions, and collisions, so
+  // the game runs exactly the same. The render thread's TIA draws every frame
+  // it's given, so it doesn't follow |frameskip| itself.
+  bool drawing_frame = true;
+  bool follows_frameskip = true;
+
+  // Audio is synthesized on the emulation thread as the CPU runs, in batches
+  // of |Sound::batch_cycles|.
+  Sound sound;
+
+  // Set while capturing a trace of register writes.
+  std::unique_ptr<TIATraceWriter> trace;
+
+  // The register write from the current instruction. It takes effect in
+  // process_tia(), once the instruction's cycles have been counted.
+  struct PendingWrite {
+    bool valid;
+    uint8_t addr;
+    uint8_t val;
+  };
+  PendingWrite pending_write = {false, 0, 0};
+
+  // Register handlers by address, with the mirrors masked off.
+  typedef uint8_t (TIA::*ReadHandler)();
+  typedef void (TIA::*WriteHandler)(uint8_t val);
+  static const ReadHandler read_handlers[0x10];
+  static const WriteHandler write_handlers[0x40];
+
+  // Apply a register write that's due now, holding it for the scanline cache
+  // if it affects drawing.
+  void write_register(uint8_t addr, uint8_t val);
+  // For the render thread. Draw up to |tia_cycle| and apply a logged write.
+  void replay_write(int64_t tia_cycle, uint8_t addr, uint8_t val);
+  // For the render thread. Start drawing a frame from a logged state.
+  void start_replay(const State &start_state, int64_t start_tia_cycle,
+                    int gun_x, int gun_y, bool start_vsync_mode);
+
+  // Decide whether to draw the frame that's starting.
+  void start_frame();
+
+  // Render every cycle up to the last process_tia() call, except for the
+  // scanline being held for the cache.
+  void catch_up();
+  // Render |tia_cycles| color clocks with the current TIA state.
+  void render(uint64_t tia_cycles);
+
+  // Start holding off on the scanline if we're at the start of one.
+  void start_line();
+  // Draw the first |cycles| of the held scanline, applying its queued writes
+  // as we go.
+  void replay_line(int cycles);
+  // Copy the held scanline from the cache, or draw it and add it.
+  void finish_line();
+  // Draw as much of the held scanline as has happened, and stop holding it.
+  void abandon_line();
+  uint64_t hash_line();
+  bool line_matches(const CachedLine &line);
+
+  // Render |count| color clocks, which must all be on the current scanline.
+  void render_scanline_span(int count);
+  // Composite up to 64 pixels starting at line position |pos|.
+  // |playfield_visible| is false during the horizontal blank, which sprites
+  // wrap around into but the playfield does not.
+  void composite(uint8_t *pixels, int pos, int count, bool playfield_visible);
+
+  // Rebuild the object lines marked dirty, setting aside the old ones for
+  // collision detection if they were drawn.
+  void build_lines();
+  void build_player_line(LineMask &line, int player_x, uint8_t player_mask,
+                         int duplicate_mask, int scale);
+  void build_missile_line(LineMask &line, int missile_x, int missile_size,
+                          bool missile_enabled, int duplicate_mask);
+
+  // Latch every collision between the given object lines where they were
+  // drawn.
+  void latch_collisions(const ObjectLines &drawn_lines);
 
   // Helper function for handling the second half of the playfield based on
   // whether or not mirror mode is enabled.
   void handle_playfield_mirror();
 
-  // Returns true if we can draw a playfield pixel here.
-  bool can_draw_playfield(int visible_x);
-  // Draw a playfield pixel at given position.
-  void draw_playfield(int visible_x);
-
-  // Returns true if we can draw a ball pixel here.
-  bool can_draw_ball(int visible_x);
-  // Draw a ball pixel.
-  void draw_ball();
-
-  // Returns true if we can draw a player pixel here. Logic is the same for both
-  // players.
-  bool can_draw_player(int visible_x, int player_x, uint8_t player_mask,
-                       int duplicate_mask, int scale);
-  // Draw a player pixel here.
-  void draw_player(uint8_t player_color);
-
-  // Returns true if we can draw a missile pixel here. Logic is the same for
-  // both pixels.
-  bool can_draw_missile(int visible_x, int missile_x, int missile_size,
-                        bool missile_enabled, int duplicate_mask);
-  // Draw a missile pixel.
-  void draw_missile(uint8_t missile_color);
-
   // Sets the given sprite position to the pixel currently being drawn, plus
   // some fudge factors. If a sprite position is reset during the horizontal
   // blanking period, the sprite will appear at the far left side of the screen,
@@ -193,6 +387,9 @@ class TIA {
   void audc0(uint8_t val);
   void audc1(uint8_t val);
 
+  TIA(Registers &regs, uint64_t &cycle_num, const Controls &controls,
+      std::unique_ptr<NTSC> ntsc);
+
 public:
   // Ratio of TIA clock to CPU clock
   const static int tia_cycle_ratio = 3;
@@ -206,15 +403,77 @@ public:
 
   std::unique_ptr<NTSC> ntsc;
 
-  TIA(int scale);
-
-  std::shared_ptr<MappedRegion> get_memory_region() { return memory_region; }
+  // If |pipelined| is set, pixels are drawn on a separate render thread. If
+  // |headless| is set, there's no window and nothing is drawn at all.
+  TIA(Registers &regs, uint64_t &cycle_num, const Controls &controls,
+      int scale, double speed, bool pipelined = false, bool headless = false);
+  // Draws into |display| on this thread, as fast as it can and without any
+  // sound. Nothing is shared with other TIAs, so any number of these can run
+  // at once. It ignores |frameskip|, see set_drawing() instead.
+  TIA(Registers &regs, uint64_t &cycle_num, const Controls &controls,
+      std::unique_ptr<Display> display);
+  ~TIA();
+
+  // Register reads and writes from the bus, with |addr| relative to
+  // TIA_START. These return false if there's no register at |addr|, and leave
+  // it to the bus to complain.
+  bool memory_read_hook(uint16_t addr, uint8_t &val);
+  bool memory_write_hook(uint16_t addr, uint8_t val);
 
   // Process outstanding TIA cycles
   void process_tia();
 
+  // Render every cycle up to the last process_tia() call and apply any writes
+  // held back for the scanline cache. Rendering otherwise waits for the next
+  // register write or the end of the scanline, so anything looking at the
+  // electron gun or the collision registers from outside needs to call this
+  // first.
+  void flush();
+
+  // Bring the collision latches up to date with everything rendered so far.
+  void resolve_collisions();
+
+  // Whether the frames from here on get drawn. Call it between frames. TIAs
+  // that follow |frameskip| go back to it when the next frame starts.
+  void set_drawing(bool drawing);
+
+  // What else a TIA needs, besides its Registers, to pick up where another
+  // left off between frames. It doesn't hold any pointers, so it can be
+  // copied around as plain bytes.
+  struct Snapshot {
+    NTSC::Snapshot ntsc;
+    Sound::Snapshot sound;
+  };
+  // Call these between instructions, and not in pipelined mode. Saving draws
+  // everything up to the last process_tia() call first, so the Registers are
+  // up to date once it returns. Load the Registers before loading the rest.
+  // Drawing is left as it is, with the scanline cache still warm.
+  void save_state(Snapshot &snapshot);
+  void load_state(const Snapshot &snapshot);
+
   // Print helpful TIA state information to STDOUT
   void dump_tia();
+
+  // Print scanline cache hit rates to STDOUT
+  void dump_line_cache_stats();
+
+  // Pipelined mode only. Have the render thread draw every frame, waiting for
+  // it when it falls behind rather than dropping frames, and wait for it to
+  // finish. For checking the render thread against the serial renderer.
+  void set_lossless_pipeline();
+  void drain_pipeline();
+
+  // Log every register write from here on to the given file, for replaying
+  // later with tia_bench.
+  void start_trace(const char *filename);
+
+  // See Sound::match_refresh().
+  void match_refresh(double refresh_hz) { sound.match_refresh(refresh_hz); }
+
+  // Write audio to the given WAV file instead of the sound card, until
+  // stop_wav().
+  void start_wav(const char *filename);
+  void stop_wav();
 };
 
 #endif
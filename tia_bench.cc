@@ -0,0 +1,202 @@
+// Replays a TIA trace captured with "check2600 -c" straight into the TIA, with
+// no CPU, and reports how fast it renders. Frame hashes can be saved and
+// compared against a later run to make sure an optimization didn't change
+// what gets drawn.
+
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+#include "display.h"
+#include "frame_stats.h"
+#include "input.h"
+#include "ntsc.h"
+#include "tia.h"
+#include "tia_trace.h"
+
+// Hashes every frame instead of showing it.
+class BenchDisplay : public Display {
+  std::unique_ptr<uint8_t[]> buf;
+  size_t size;
+
+public:
+  std::vector<uint64_t> frame_hashes;
+
+  BenchDisplay(int width, int height) {
+    size = width * height;
+    buf = std::make_unique<uint8_t[]>(size);
+    framebuf = buf.get();
+  }
+
+  void swap_buf() override {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < size; i++) {
+      hash ^= framebuf[i];
+      hash *= 0x100000001b3;
+    }
+    frame_hashes.push_back(hash);
+  }
+};
+
+BenchDisplay *bench_display = nullptr;
+
+// Nothing is shown, so there's nothing to scale.
+std::unique_ptr<Display> create_display(int width, int height, int) {
+  auto display = std::make_unique<BenchDisplay>(width, height);
+  bench_display = display.get();
+  return display;
+}
+
+void request_quit() {}
+
+void print_usage_and_exit() {
+  printf("Usage: tia_bench [-p] [-k frameskip] [-n runs] [-w hashes.txt] "
+         "[-c hashes.txt] <trace_file>\n");
+  printf("-p: Draw frames on a render thread like check2600 -p, but without\n");
+  printf("    ever dropping one.\n");
+  printf("-k: Draw one frame in every N, like check2600 -k. Default is 1.\n");
+  printf("-n: Replay the trace this many times. Default is 5.\n");
+  printf("-w: Write the hash of every frame to the given file.\n");
+  printf("-c: Compare the hash of every frame against the given file.\n");
+  printf("-h: Show this help menu and exit.\n");
+  exit(0);
+}
+
+// Replays the whole trace on a fresh TIA, so the scanline cache starts cold
+// every time. Returns the hashes of the frames drawn.
+std::vector<uint64_t> replay(const char *filename, bool pipelined,
+                             uint64_t &color_clocks, uint64_t &elapsed_ns) {
+  uint64_t cycle_num = 0;
+  TIA::Registers regs;
+  auto tia =
+      std::make_unique<TIA>(regs, cycle_num, controls, 1, 0, pipelined);
+  tia->set_lossless_pipeline();
+  TIATraceReader reader(filename, *tia);
+  uint64_t start_cycle = cycle_num;
+
+  uint64_t start = host_time_ns();
+  uint64_t cycle;
+  uint8_t addr;
+  uint8_t val;
+  while (reader.next_write(cycle, addr, val)) {
+    cycle_num = cycle;
+    tia->memory_write_hook(addr, val);
+    tia->process_tia();
+  }
+  tia->flush();
+  tia->drain_pipeline();
+  elapsed_ns = host_time_ns() - start;
+
+  color_clocks = (cycle_num - start_cycle) * TIA::tia_cycle_ratio;
+  return bench_display->frame_hashes;
+}
+
+int main(int argc, char **argv) {
+  int runs = 5;
+  bool pipelined = false;
+  const char *write_filename = nullptr;
+  const char *compare_filename = nullptr;
+
+  int c;
+  while ((c = getopt(argc, argv, "hpk:n:w:c:")) != -1) {
+    switch (c) {
+    case 'h':
+      print_usage_and_exit();
+      break;
+    case 'p':
+      pipelined = true;
+      break;
+    case 'k':
+      frameskip = atoi(optarg);
+      if (frameskip <= 0) {
+        printf("Error! Invalid frameskip %s\n", optarg);
+        exit(-1);
+      }
+      break;
+    case 'n':
+      runs = atoi(optarg);
+      if (runs <= 0) {
+        printf("Error! Invalid number of runs %s\n", optarg);
+        exit(-1);
+      }
+      break;
+    case 'w':
+      write_filename = optarg;
+      break;
+    case 'c':
+      compare_filename = optarg;
+      break;
+    default:
+      print_usage_and_exit();
+    }
+  }
+
+  if (optind != argc - 1)
+    print_usage_and_exit();
+  const char *trace_filename = argv[optind];
+
+  std::vector<uint64_t> hashes;
+  uint64_t best_ns = UINT64_MAX;
+  uint64_t color_clocks = 0;
+  for (int i = 0; i < runs; i++) {
+    uint64_t elapsed_ns;
+    auto run_hashes =
+        replay(trace_filename, pipelined, color_clocks, elapsed_ns);
+    if (i && run_hashes != hashes) {
+      printf("Error! Run %d drew different frames than run 1\n", i + 1);
+      exit(-1);
+    }
+    hashes = run_hashes;
+
+    printf("Run %d: %.3f ms\n", i + 1, elapsed_ns / 1e6);
+    if (elapsed_ns < best_ns)
+      best_ns = elapsed_ns;
+  }
+
+  printf("%lu frames, %lu color clocks\n", hashes.size(), color_clocks);
+  printf("Best run: %.3f ms, %.1f Mpixels/s, %.1f frames/s\n", best_ns / 1e6,
+         color_clocks * 1e3 / best_ns, hashes.size() * 1e9 / best_ns);
+
+  if (write_filename) {
+    FILE *file = fopen(write_filename, "w");
+    if (!file) {
+      printf("could not open %s\n", write_filename);
+      exit(-1);
+    }
+    for (uint64_t hash : hashes)
+      fprintf(file, "%016lx\n", hash);
+    fclose(file);
+  }
+
+  if (compare_filename) {
+    FILE *file = fopen(compare_filename, "r");
+    if (!file) {
+      printf("could not open %s\n", compare_filename);
+      exit(-1);
+    }
+    std::vector<uint64_t> expected;
+    uint64_t hash;
+    while (fscanf(file, "%lx", &hash) == 1)
+      expected.push_back(hash);
+    fclose(file);
+
+    if (expected.size() != hashes.size()) {
+      printf("Frame hashes differ: expected %lu frames, drew %lu\n",
+             expected.size(), hashes.size());
+      return 1;
+    }
+    for (size_t i = 0; i < hashes.size(); i++) {
+      if (hashes[i] != expected[i]) {
+        printf("Frame hashes differ, starting at frame %lu\n", i);
+        return 1;
+      }
+    }
+    printf("Frame hashes match\n");
+  }
+
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include "tia_pipeline.h"
+
+#include <chrono>
+
+#include "display.h"
+#include "frame_stats.h"
+#include "ntsc.h"
+
+TIAPipeline::TIAPipeline(TIA &tia, int scale) : tia(tia) {
+  head = 0;
+  tail = 0;
+
+  // The emulation thread's NTSC keeps time, so this one draws as fast as it
+  // can.
+  renderer = std::unique_ptr<TIA>(new TIA(
+      renderer_regs, tia.cycle_num, tia.controls,
+      std::make_unique<NTSC>(create_display(NTSC::visible_columns,
+                                            NTSC::visible_scanlines, scale),
+                             0, false)));
+  renderer->track_collisions = false;
+  renderer->follows_frameskip = false;
+
+  begin_frame();
+
+  running = true;
+  render_thread =
+      std::make_unique<std::thread>(&TIAPipeline::render_frames, this);
+}
+
+TIAPipeline::~TIAPipeline() {
+  running = false;
+  render_thread->join();
+}
+
+void TIAPipeline::begin_frame() {
+  FrameLog &frame = frames[head % ring_size];
+  frame.state = tia.state;
+  frame.tia_cycle = tia.regs.tia_cycle_num;
+  frame.gun_x = tia.ntsc->gun_x;
+  frame.gun_y = tia.ntsc->gun_y;
+  frame.vsync_mode = tia.regs.vsync_mode;
+  frame.writes.clear();
+}
+
+void TIAPipeline::log_write(int64_t tia_cycle, uint8_t addr, uint8_t val) {
+  FrameLog &frame = frames[head % ring_size];
+  if (frame.writes.size() >= max_frame_writes) {
+    begin_frame();
+    return;
+  }
+
+  frame.writes.push_back({tia_cycle, addr, val});
+}
+
+void TIAPipeline::end_frame(bool wanted) {
+  uint64_t next = head.load(std::memory_order_relaxed) + 1;
+
+  while (lossless && wanted &&
+         next - tail.load(std::memory_order_acquire) >= ring_size)
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+  // Keep the slot we're logging into out of the render thread's hands.
+  if (wanted) {
+    if (next - tail.load(std::memory_order_acquire) < ring_size)
+      head.store(next, std::memory_order_release);
+    else
+      frame_stats.add_dropped_frame();
+  }
+
+  begin_frame();
+}
+
+void TIAPipeline::drain() {
+  while (tail.load(std::memory_order_acquire) !=
+         head.load(std::memory_order_relaxed))
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+void TIAPipeline::render_frames() {
+  while (running) {
+    uint64_t next = tail.load(std::memory_order_relaxed);
+    if (next == head.load(std::memory_order_acquire)) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      continue;
+    }
+
+    // The last write of every frame is the VSYNC that ends it, which is what
+    // sends the frame to the display.
+    const FrameLog &frame = frames[next % ring_size];
+    renderer->start_replay(frame.state, frame.tia_cycle, frame.gun_x,
+                           frame.gun_y, frame.vsync_mode);
+    for (const LoggedWrite &write : frame.writes)
+      renderer->replay_write(write.tia_cycle, write.addr, write.val);
+
+    tail.store(next + 1, std::memory_order_release);
+  }
+}
@@ -0,0 +1,81 @@
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#include "tia.h"
+
+#ifndef TIA_PIPELINE_H
+#define TIA_PIPELINE_H
+
+// Draws frames on a separate render thread so the emulation thread only has
+// to run the CPU and work out collisions. The emulation thread logs the TIA
+// state at the start of each frame along with every register write during it,
+// and the render thread replays the log on a TIA of its own.
+class TIAPipeline {
+  struct LoggedWrite {
+    int64_t tia_cycle;
+    uint8_t addr;
+    uint8_t val;
+  };
+
+  struct FrameLog {
+    TIA::State state;
+    int64_t tia_cycle;
+    int gun_x;
+    int gun_y;
+    bool vsync_mode;
+    std::vector<LoggedWrite> writes;
+  };
+
+  // Single producer, single consumer ring of frame logs. The emulation thread
+  // fills in frames[head % ring_size] and the render thread works through
+  // everything from tail up to head. Each frame starts from a complete TIA
+  // state, so if the render thread falls behind we can drop a frame by just
+  // logging over it.
+  const static int ring_size = 4;
+  FrameLog frames[ring_size];
+  std::atomic<uint64_t> head;
+  std::atomic<uint64_t> tail;
+
+  // A game that never does VSYNC would otherwise log forever.
+  const static size_t max_frame_writes = 1 << 16;
+
+  TIA &tia;
+  // The render thread's TIA, and the registers it draws from.
+  TIA::Registers renderer_regs;
+  std::unique_ptr<TIA> renderer;
+
+  std::atomic<bool> running;
+  std::unique_ptr<std::thread> render_thread;
+
+  void render_frames();
+
+public:
+  // |tia| is the emulation thread's TIA. Frames are drawn to a new display
+  // scaled up by |scale|.
+  TIAPipeline(TIA &tia, int scale);
+  ~TIAPipeline();
+
+  // Emulation thread side. Start logging a new frame from the TIA's current
+  // state, dropping whatever has been logged of the current one.
+  void begin_frame();
+
+  // Emulation thread side. Log a register write at the given TIA cycle.
+  void log_write(int64_t tia_cycle, uint8_t addr, uint8_t val);
+
+  // Emulation thread side. Hand the logged frame to the render thread if
+  // |wanted|, or drop it if it isn't or the render thread is too far behind.
+  void end_frame(bool wanted);
+
+  // Wait for the render thread to catch up instead of dropping frames, so the
+  // frames it draws can be checked against the serial renderer.
+  bool lossless = false;
+
+  // Emulation thread side. Wait until every frame handed over so far has been
+  // drawn.
+  void drain();
+};
+
+#endif
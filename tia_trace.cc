@@ -0,0 +1,109 @@
+#include "tia_trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ntsc.h"
+
+static const char trace_magic[4] = {'T', 'I', 'A', 'T'};
+static const uint32_t trace_version = 2;
+
+TIATraceWriter::TIATraceWriter(const char *filename, TIA &tia) {
+  file = fopen(filename, "wb");
+  if (!file) {
+    printf("could not open %s\n", filename);
+    exit(-1);
+  }
+
+  // Anything held back for the scanline cache has to be in the state we
+  // start from.
+  tia.flush();
+  tia.resolve_collisions();
+
+  TIATraceHeader header = {};
+  memcpy(header.magic, trace_magic, sizeof(trace_magic));
+  header.version = trace_version;
+  header.cycle_num = tia.cycle_num;
+  header.tia_cycle_num = tia.regs.tia_cycle_num;
+  header.state = tia.state;
+  header.gun_x = tia.ntsc->gun_x;
+  header.gun_y = tia.ntsc->gun_y;
+  header.collisions = tia.regs.collisions;
+  header.vsync_mode = tia.regs.vsync_mode;
+  fwrite(&header, sizeof(header), 1, file);
+
+  last_cycle_num = tia.cycle_num;
+}
+
+TIATraceWriter::~TIATraceWriter() { fclose(file); }
+
+void TIATraceWriter::log_write(uint64_t cycle, uint8_t addr, uint8_t val) {
+  uint64_t delta = cycle - last_cycle_num;
+  last_cycle_num = cycle;
+
+  uint8_t record[12];
+  int len = 0;
+  do {
+    record[len] = delta & 0x7F;
+    delta >>= 7;
+    if (delta)
+      record[len] |= 0x80;
+    len++;
+  } while (delta);
+  record[len++] = addr;
+  record[len++] = val;
+  fwrite(record, 1, len, file);
+}
+
+TIATraceReader::TIATraceReader(const char *filename, TIA &tia) {
+  file = fopen(filename, "rb");
+  if (!file) {
+    printf("could not open %s\n", filename);
+    exit(-1);
+  }
+
+  TIATraceHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      memcmp(header.magic, trace_magic, sizeof(trace_magic)) ||
+      header.version != trace_version) {
+    printf("Error! %s is not a TIA trace\n", filename);
+    exit(-1);
+  }
+
+  tia.cycle_num = header.cycle_num;
+  tia.regs.last_process_cycle_num = header.cycle_num;
+  tia.rendered_cycle_num = header.cycle_num;
+  tia.sound.seek(header.cycle_num);
+  tia.start_replay(header.state, header.tia_cycle_num, header.gun_x,
+                   header.gun_y, header.vsync_mode);
+  tia.regs.collisions = header.collisions;
+
+  last_cycle_num = header.cycle_num;
+}
+
+TIATraceReader::~TIATraceReader() { fclose(file); }
+
+bool TIATraceReader::next_write(uint64_t &cycle, uint8_t &addr,
+                                uint8_t &val) {
+  uint64_t delta = 0;
+  int shift = 0;
+  int c;
+  do {
+    c = getc(file);
+    if (c == EOF)
+      return false;
+    delta |= (uint64_t)(c & 0x7F) << shift;
+    shift += 7;
+  } while (c & 0x80);
+
+  int addr_byte = getc(file);
+  int val_byte = getc(file);
+  if (addr_byte == EOF || val_byte == EOF)
+    return false;
+
+  last_cycle_num += delta;
+  cycle = last_cycle_num;
+  addr = addr_byte;
+  val = val_byte;
+  return true;
+}
@@ -0,0 +1,55 @@
+#include <stdint.h>
+#include <stdio.h>
+
+#include "tia.h"
+
+#ifndef TIA_TRACE_H
+#define TIA_TRACE_H
+
+// Traces of TIA register writes, for working on the TIA without a CPU in the
+// way. A trace starts with a header holding the TIA state when capture
+// started, followed by one record per write: the number of CPU cycles since
+// the previous write as an LEB128 varint, then the register address and the
+// value written. Everything is in host byte order.
+struct TIATraceHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t cycle_num;
+  int64_t tia_cycle_num;
+  TIA::State state;
+  int32_t gun_x;
+  int32_t gun_y;
+  uint16_t collisions;
+  uint8_t vsync_mode;
+  uint8_t padding[5];
+};
+static_assert(sizeof(TIATraceHeader) == 128,
+              "TIATraceHeader must not have any padding");
+
+class TIATraceWriter {
+  FILE *file;
+  uint64_t last_cycle_num;
+
+public:
+  // Starts a trace of |tia| from its current state.
+  TIATraceWriter(const char *filename, TIA &tia);
+  ~TIATraceWriter();
+
+  void log_write(uint64_t cycle, uint8_t addr, uint8_t val);
+};
+
+class TIATraceReader {
+  FILE *file;
+  uint64_t last_cycle_num;
+
+public:
+  // Opens a trace and puts |tia|, along with the cycle counter it's timed
+  // against, back the way they were when capture started.
+  TIATraceReader(const char *filename, TIA &tia);
+  ~TIATraceReader();
+
+  // Reads the next write. Returns false at the end of the trace.
+  bool next_write(uint64_t &cycle, uint8_t &addr, uint8_t &val);
+};
+
+#endif
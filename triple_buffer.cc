@@ -0,0 +1,35 @@
+#include "triple_buffer.h"
+
+#include <stdlib.h>
+
+TripleBuffer::TripleBuffer(size_t size) {
+  for (int i = 0; i < 3; i++) {
+    buffers[i] = (uint8_t *)calloc(size, 1);
+    stamps[i] = 0;
+  }
+
+  back = 0;
+  middle = 1;
+  front = 2;
+}
+
+TripleBuffer::~TripleBuffer() {
+  for (int i = 0; i < 3; i++)
+    free(buffers[i]);
+}
+
+uint8_t *TripleBuffer::publish(uint64_t stamp) {
+  stamps[back] = stamp;
+  int prev = middle.exchange(back | fresh_bit, std::memory_order_acq_rel);
+  back = prev & index_mask;
+  return buffers[back];
+}
+
+bool TripleBuffer::fetch() {
+  if (!(middle.load(std::memory_order_relaxed) & fresh_bit))
+    return false;
+
+  int prev = middle.exchange(front, std::memory_order_acq_rel);
+  front = prev & index_mask;
+  return true;
+}
@@ -0,0 +1,51 @@
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+// Lock-free triple buffer for handing whole frames from one producer thread to
+// one consumer thread. The producer always has a buffer to draw into and the
+// consumer always has the newest complete frame, so neither side ever waits on
+// the other. Frames the consumer is too slow to pick up are simply dropped.
+class TripleBuffer {
+  uint8_t *buffers[3];
+  // Caller supplied tag for each buffer, e.g. when it was published.
+  uint64_t stamps[3];
+
+  // The buffer in the middle of the handoff. The low bits are its index, and
+  // fresh_bit is set if the producer published it since the consumer last
+  // looked.
+  std::atomic<int> middle;
+  const static int index_mask = 0x3;
+  const static int fresh_bit = 0x4;
+
+  // Only touched by the producer.
+  int back;
+  // Only touched by the consumer.
+  int front;
+
+public:
+  TripleBuffer(size_t size);
+  ~TripleBuffer();
+
+  // Producer side. The buffer to draw the next frame into.
+  uint8_t *get_back() { return buffers[back]; }
+
+  // Producer side. Hands the back buffer to the consumer with a single atomic
+  // swap and returns the new back buffer. Note that the new back buffer holds
+  // an older frame, not the one just published. |stamp| travels along with the
+  // frame.
+  uint8_t *publish(uint64_t stamp = 0);
+
+  // Consumer side. Picks up the newest published frame, if there is one.
+  // Returns false if nothing was published since the last call.
+  bool fetch();
+
+  // Consumer side. The frame picked up by the last successful fetch().
+  const uint8_t *get_front() { return buffers[front]; }
+  uint64_t get_front_stamp() { return stamps[front]; }
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "wav_writer.h"
+
+#include <stdlib.h>
+
+// Everything in a WAV file is little endian, same as the host.
+struct WavHeader {
+  char riff[4];
+  uint32_t riff_bytes;
+  char wave[4];
+  char fmt[4];
+  uint32_t fmt_bytes;
+  uint16_t format;
+  uint16_t channels;
+  uint32_t sample_rate;
+  uint32_t byte_rate;
+  uint16_t block_align;
+  uint16_t bits_per_sample;
+  char data[4];
+  uint32_t data_bytes;
+};
+static_assert(sizeof(WavHeader) == 44, "WavHeader must not have any padding");
+
+WavWriter::WavWriter(const char *filename, int sample_rate) {
+  file = fopen(filename, "wb");
+  if (!file) {
+    printf("could not open %s\n", filename);
+    exit(-1);
+  }
+
+  WavHeader header = {{'R', 'I', 'F', 'F'},
+                      0,
+                      {'W', 'A', 'V', 'E'},
+                      {'f', 'm', 't', ' '},
+                      16,
+                      1,
+                      1,
+                      (uint32_t)sample_rate,
+                      (uint32_t)(sample_rate * sizeof(int16_t)),
+                      sizeof(int16_t),
+                      16,
+                      {'d', 'a', 't', 'a'},
+                      0};
+  fwrite(&header, sizeof(header), 1, file);
+}
+
+WavWriter::~WavWriter() {
+  uint32_t riff_bytes = sizeof(WavHeader) - 8 + data_bytes;
+  fseek(file, offsetof(WavHeader, riff_bytes), SEEK_SET);
+  fwrite(&riff_bytes, sizeof(riff_bytes), 1, file);
+  fseek(file, offsetof(WavHeader, data_bytes), SEEK_SET);
+  fwrite(&data_bytes, sizeof(data_bytes), 1, file);
+  fclose(file);
+}
+
+void WavWriter::write(const int16_t *samples, size_t count) {
+  fwrite(samples, sizeof(int16_t), count, file);
+  data_bytes += count * sizeof(int16_t);
+}
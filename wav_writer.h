@@ -0,0 +1,23 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef WAV_WRITER_H
+#define WAV_WRITER_H
+
+// Writes 16-bit mono PCM to a WAV file. The sizes in the header aren't known
+// until we're done, so they're filled in when the writer is destroyed.
+class WavWriter {
+  FILE *file;
+  uint32_t data_bytes = 0;
+
+public:
+  WavWriter(const char *filename, int sample_rate);
+  ~WavWriter();
+
+  void write(const int16_t *samples, size_t count);
+
+  size_t samples_written() { return data_bytes / sizeof(int16_t); }
+};
+
+#endif